@@ -0,0 +1,148 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JUK_BOUNDEDQUEUE_H
+#define JUK_BOUNDEDQUEUE_H
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QVector>
+#include <QWaitCondition>
+
+/**
+ * A queue between the threads of a pipeline, holding at most a fixed number
+ * of items.  Producers block while it is full, which keeps a fast stage from
+ * running arbitrarily far ahead of a slow one, and consumers block while it
+ * is empty until the producers close() it.
+ */
+template<typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(int capacity) : m_capacity(qMax(1, capacity))
+    {
+    }
+
+    /**
+     * Appends \a item, waiting while the queue is full.  Returns false
+     * without adding the item if the queue was closed.
+     */
+    bool push(const T &item)
+    {
+        QMutexLocker locker(&m_lock);
+
+        while(!m_closed && m_items.count() >= m_capacity)
+            m_notFull.wait(&m_lock);
+
+        if(m_closed)
+            return false;
+
+        m_items.enqueue(item);
+        m_notEmpty.wakeOne();
+        return true;
+    }
+
+    /**
+     * Takes the first item into \a item, waiting while the queue is empty.
+     * Returns false once the queue is closed and has been drained.
+     */
+    bool pop(T &item)
+    {
+        QMutexLocker locker(&m_lock);
+
+        while(!m_closed && m_items.isEmpty())
+            m_notEmpty.wait(&m_lock);
+
+        if(m_items.isEmpty())
+            return false;
+
+        item = m_items.dequeue();
+        m_notFull.wakeOne();
+        return true;
+    }
+
+    /**
+     * Takes up to \a max items without waiting.
+     */
+    QVector<T> tryPop(int max)
+    {
+        QMutexLocker locker(&m_lock);
+
+        QVector<T> items;
+        items.reserve(qMin(max, m_items.count()));
+
+        while(items.count() < max && !m_items.isEmpty())
+            items.append(m_items.dequeue());
+
+        if(!items.isEmpty())
+            m_notFull.wakeAll();
+
+        return items;
+    }
+
+    /**
+     * Marks the end of the items.  What is queued can still be taken.
+     */
+    void close()
+    {
+        QMutexLocker locker(&m_lock);
+        m_closed = true;
+        m_notFull.wakeAll();
+        m_notEmpty.wakeAll();
+    }
+
+    /**
+     * Closes the queue and drops everything in it.
+     */
+    void abort()
+    {
+        QMutexLocker locker(&m_lock);
+        m_closed = true;
+        m_items.clear();
+        m_notFull.wakeAll();
+        m_notEmpty.wakeAll();
+    }
+
+    int count() const
+    {
+        QMutexLocker locker(&m_lock);
+        return m_items.count();
+    }
+
+    int capacity() const { return m_capacity; }
+
+    /**
+     * Returns true if the queue is closed and empty.
+     */
+    bool isFinished() const
+    {
+        QMutexLocker locker(&m_lock);
+        return m_closed && m_items.isEmpty();
+    }
+
+private:
+    const int m_capacity;
+    mutable QMutex m_lock;
+    QWaitCondition m_notFull;
+    QWaitCondition m_notEmpty;
+    QQueue<T> m_items;
+    bool m_closed = false;
+};
+
+#endif
+
+// vim: set et sw=4 tw=0 sta:
@@ -24,13 +24,27 @@
 #include <KLocalizedString>
 
 #include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
 #include <QSaveFile>
+#include <QtConcurrent>
+#include <QtEndian>
 
+#include <algorithm>
+#include <limits>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+#include "crc32c.h"
+#include "filehandle.h"
 #include "juktag.h"
 #include "searchplaylist.h"
 #include "historyplaylist.h"
 #include "upcomingplaylist.h"
 #include "folderplaylist.h"
+#include "collectionlist.h"
 #include "playlistcollection.h"
 #include "actioncollection.h"
 #include "juk.h"
@@ -38,8 +52,8 @@
 
 using namespace ActionCollection;
 
-const int Cache::playlistListCacheVersion = 3;
-const int Cache::playlistItemsCacheVersion = 2;
+const int Cache::playlistListCacheVersion = 4;
+const int Cache::playlistItemsCacheVersion = 6;
 
 enum PlaylistType
 {
@@ -50,6 +64,342 @@ enum PlaylistType
     Folder   = 4
 };
 
+// Layout of the memory-mapped collection cache (version 5 and later).  All
+// values are little-endian except for the leading version number, which is
+// big-endian to match what QDataStream wrote for the older formats.
+//
+//   header | segment directory | segment 0 | segment 1 | ...
+//
+// The tracks are split into segments of at most tracksPerSegment tracks, each
+// of which can be decoded on its own (and so on its own thread).  A segment
+// is the table of its tracks' paths, a run of fixed-width track records and
+// then the string table for the rest of the metadata.
+//
+// String fields in the record are byte offsets into the path or string
+// table, where each distinct string is stored once as a quint32 length (in
+// UTF-16 code units) followed by its UTF-16 data, padded to a multiple of 4
+// bytes.  Offset 0 is always the empty string.
+//
+// The header and directory, the paths and the rest of each segment all have
+// their own CRC-32C.  If only the rest of a segment is damaged its tracks can
+// still be read again from the files themselves.
+
+namespace MappedCache
+{
+    const quint32 magic = 0x434b754a; // "JuKC"
+    const int tracksPerSegment = 1024;
+
+    enum HeaderField {
+        HeaderVersion      = 0,
+        HeaderMagic        = 4,
+        HeaderSegmentCount = 8,
+        HeaderRecordSize   = 12,
+        HeaderGeneration   = 16, // Which journal batches still apply, see Journal
+        HeaderChecksum     = 20, // Of the fields above and the segment directory
+        HeaderSize         = 32
+    };
+
+    enum SegmentField {
+        SegmentStart         = 0, // Offset of the path table from the start of the file
+        SegmentRecordCount   = 4,
+        SegmentPathsSize     = 8,
+        SegmentStringsSize   = 12,
+        SegmentPathsChecksum = 16,
+        SegmentChecksum      = 20, // Of the records and the string table
+        SegmentEntrySize     = 24
+    };
+
+    enum RecordField {
+        RecordPath     = 0,  // Offset into the path table
+        RecordTitle    = 4,
+        RecordArtist   = 8,
+        RecordAlbum    = 12,
+        RecordGenre    = 16,
+        RecordComment  = 20,
+        RecordTrack    = 24,
+        RecordYear     = 28,
+        RecordSeconds  = 32,
+        RecordBitrate  = 36,
+        RecordFlags    = 40, // RecordFlag bits, 0 if nothing is known
+        RecordCacheId  = 44, // FileHandle::cacheId(), 0 in version 5
+        RecordModified = 48, // qint64 msecs since epoch
+        RecordSize     = 56
+    };
+
+    enum RecordFlag {
+        FlagEmbeddedArtChecked  = 0x1,
+        FlagHasEmbeddedArt      = 0x2,
+        FlagPropertiesEstimated = 0x4  // See Tag::propertiesEstimated()
+    };
+
+    inline quint32 u32(const uchar *p)
+    {
+        return qFromLittleEndian<quint32>(p);
+    }
+
+    inline quint32 recordFlags(const Tag *tag)
+    {
+        quint32 flags = tag->propertiesEstimated() ? FlagPropertiesEstimated : 0;
+
+        switch(tag->embeddedArt()) {
+        case Tag::HasEmbeddedArt:
+            return flags | FlagEmbeddedArtChecked | FlagHasEmbeddedArt;
+        case Tag::NoEmbeddedArt:
+            return flags | FlagEmbeddedArtChecked;
+        default:
+            return flags;
+        }
+    }
+
+    inline void applyRecordFlags(Tag *tag, quint32 flags)
+    {
+        if(flags & FlagEmbeddedArtChecked) {
+            tag->setEmbeddedArt((flags & FlagHasEmbeddedArt)
+                ? Tag::HasEmbeddedArt : Tag::NoEmbeddedArt);
+        }
+
+        tag->setPropertiesEstimated(flags & FlagPropertiesEstimated);
+    }
+
+    inline void putU32(QByteArray &data, int offset, quint32 value)
+    {
+        qToLittleEndian<quint32>(value, data.data() + offset);
+    }
+
+    // Checksums the header fields before the checksum and the directory that
+    // follows the header.
+    inline quint32 headerChecksum(const char *header, quint32 size)
+    {
+        const quint32 crc = crc32c(header, HeaderChecksum);
+        return crc32c(header + HeaderSize, size - HeaderSize, crc);
+    }
+
+    /**
+     * Builds the string table as records are written, storing each distinct
+     * string only once.
+     */
+    class StringTable
+    {
+    public:
+        StringTable()
+        {
+            add(QString());
+        }
+
+        quint32 add(const QString &str)
+        {
+            const auto it = m_offsets.constFind(str);
+            if(it != m_offsets.constEnd())
+                return *it;
+
+            const quint32 offset = quint32(m_data.size());
+            const int length = str.size();
+            const int padded = (4 + 2 * length + 3) & ~3;
+
+            m_data.resize(offset + padded);
+            char *dest = m_data.data() + offset;
+            std::fill(dest, dest + padded, 0);
+
+            qToLittleEndian<quint32>(quint32(length), dest);
+            qToLittleEndian<quint16>(str.utf16(), length, dest + 4);
+
+            m_offsets.insert(str, offset);
+            return offset;
+        }
+
+        const QByteArray &data() const { return m_data; }
+
+    private:
+        QHash<QString, quint32> m_offsets;
+        QByteArray m_data;
+    };
+
+    /**
+     * Reads strings back out of one segment's string table.  Each segment
+     * being decoded has its own reader, so no locking is needed.
+     */
+    class StringReader
+    {
+    public:
+        StringReader(const uchar *strings, quint32 size) :
+            m_strings(strings),
+            m_size(size)
+        {
+        }
+
+        // Returns the string stored at offset.  Strings that repeat between
+        // tracks (artist, album, ...) are shared between all the tags of the
+        // segment that use them if share is true.
+        QString string(quint32 offset, bool share)
+        {
+            if(share) {
+                const auto it = m_shared.constFind(offset);
+                if(it != m_shared.constEnd())
+                    return *it;
+            }
+
+            const uchar *stored = entry(offset);
+            if(!stored)
+                return QString();
+
+            const QString result = CacheMapping::string(stored);
+
+            if(share)
+                m_shared.insert(offset, result);
+
+            return result;
+        }
+
+        // Returns the table entry at offset, for CacheMapping::string(), or
+        // nullptr if offset is out of bounds.
+        const uchar *entry(quint32 offset) const
+        {
+            if(offset > m_size - 4)
+                return nullptr;
+
+            const quint32 length = u32(m_strings + offset);
+            if(length > (m_size - offset - 4) / 2)
+                return nullptr;
+
+            return m_strings + offset;
+        }
+
+        // Returns all of the strings in the table in the order they were
+        // added, other than the empty string.
+        QStringList strings() const
+        {
+            QStringList result;
+
+            for(quint32 offset = 4; offset <= m_size - 4;) {
+                const quint32 length = u32(m_strings + offset);
+                if(length > (m_size - offset - 4) / 2)
+                    break;
+
+                result << CacheMapping::string(m_strings + offset);
+
+                offset += (4 + 2 * length + 3) & ~3;
+            }
+
+            return result;
+        }
+
+    private:
+        const uchar *m_strings;
+        quint32 m_size;
+        QHash<quint32, QString> m_shared;
+    };
+}
+
+// The journal holds the changes made to the collection since the snapshot in
+// the mapped cache file was written, so that saving doesn't need to rewrite
+// the whole collection.  It's a QDataStream of
+//
+//   version | magic | batch | batch | ...
+//
+// where each batch is the generation of the snapshot it applies on top of,
+// a QByteArray of entries and the CRC-32C of that QByteArray, so a damaged
+// batch only loses the changes in it.  Batches are
+// only ever appended; compaction writes a new snapshot with the next
+// generation number and then drops the batches that are older than it.
+
+namespace Journal
+{
+    // Version 2 lacked the cache IDs and version 3 the record flags.  Those
+    // are still replayed, but then replaced by a snapshot rather than
+    // appended to.
+    const qint32 version = 4;
+    const qint32 oldestVersion = 2;
+    const quint32 magic = 0x4a4b754a; // "JuKJ"
+
+    // Compact once the journal is larger than this fraction of the snapshot
+    // (or minimumCompactionSize, for small collections).
+    const int compactionRatio = 4;
+    const qint64 minimumCompactionSize = 256 * 1024;
+
+    enum EntryType {
+        Put    = 1, // Added or retagged
+        Remove = 2
+    };
+
+    QString fileName()
+    {
+        return Cache::fileHandleCacheFileName() + ".journal";
+    }
+
+    void writeHeader(QDataStream &s)
+    {
+        s << version << magic;
+    }
+
+    void writeBatch(QDataStream &s, quint32 generation, const QByteArray &batch)
+    {
+        s << generation << batch << crc32c(batch.constData(), batch.size());
+    }
+
+    // QSaveFile syncs in commit(), but the journal is appended to.
+    bool syncToDisk(QFile &f)
+    {
+        if(!f.flush())
+            return false;
+
+#ifdef Q_OS_UNIX
+        return ::fsync(f.handle()) == 0;
+#else
+        return true;
+#endif
+    }
+
+    enum BatchStatus {
+        BatchOk,
+        BatchCorrupt,  // The batch is damaged but the ones after it can be read
+        BatchTruncated // Usually because JuK went away while it was written
+    };
+
+    BatchStatus readBatch(QDataStream &s, quint32 &generation, QByteArray &batch)
+    {
+        quint32 checksum;
+        s >> generation >> batch >> checksum;
+
+        if(s.status() != QDataStream::Ok)
+            return BatchTruncated;
+
+        return checksum == crc32c(batch.constData(), batch.size()) ? BatchOk : BatchCorrupt;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CacheMapping
+////////////////////////////////////////////////////////////////////////////////
+
+CacheMapping::CacheMapping(const QString &fileName) :
+    m_file(fileName)
+{
+    if(!m_file.open(QIODevice::ReadOnly))
+        return;
+
+    m_size = m_file.size();
+    m_data = m_file.map(0, m_size);
+
+    if(!m_data)
+        qCCritical(JUK_LOG) << "Unable to map the music cache:" << m_file.errorString();
+}
+
+CacheMapping::~CacheMapping()
+{
+    if(m_data)
+        m_file.unmap(m_data);
+}
+
+QString CacheMapping::string(const uchar *entry) // static
+{
+    const quint32 length = MappedCache::u32(entry);
+
+    QString result(int(length), Qt::Uninitialized);
+    qFromLittleEndian<quint16>(entry + 4, length, result.data());
+
+    return result;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // public methods
 ////////////////////////////////////////////////////////////////////////////////
@@ -140,7 +490,7 @@ void Cache::loadPlaylists(PlaylistCollection *collection) // static
     qint32 version;
     fs >> version;
 
-    if(version != 3 || fs.status() != QDataStream::Ok) {
+    if(version < 3 || version > playlistListCacheVersion || fs.status() != QDataStream::Ok) {
         // Either the file is corrupt or is from a truly ancient version
         // of JuK.
         qCWarning(JUK_LOG) << "Found the playlist cache but it was clearly corrupt.";
@@ -160,31 +510,37 @@ void Cache::loadPlaylists(PlaylistCollection *collection) // static
     QDataStream s(&data, QIODevice::ReadOnly);
     s.setVersion(QDataStream::Qt_4_3);
 
+    Cache *cache = instance();
+    cache->m_loadingPlaylistsVersion = version;
+
+    if(version >= 4)
+        cache->readPlaylistTrackTable(s);
+
     try { // Loading failures are indicated by an exception
+        if(s.status() != QDataStream::Ok)
+            throw BICStreamException();
+
         parsePlaylistStream(s, collection);
     }
     catch(BICStreamException &) {
         qCCritical(JUK_LOG) << "Exception loading playlists - binary incompatible stream.";
         // TODO Restructure the Playlist data model and PlaylistCollection data model
         // to be separate from the view/controllers.
-        return;
     }
+
+    cache->m_movedPlaylistTracks.clear();
+    cache->m_loadingPlaylistsVersion = 0;
 }
 
 void Cache::savePlaylists(const PlaylistList &playlists)
 {
-    QString playlistsFile = playlistsCacheFileName();
-    QSaveFile f(playlistsFile);
-
-    if(!f.open(QIODevice::WriteOnly)) {
-        qCCritical(JUK_LOG) << "Error saving collection:" << f.errorString();
-        return;
-    }
-
-    QByteArray data;
-    QDataStream s(&data, QIODevice::WriteOnly);
+    QByteArray playlistData;
+    QDataStream s(&playlistData, QIODevice::WriteOnly);
     s.setVersion(QDataStream::Qt_4_3);
 
+    Cache *cache = instance();
+    cache->m_savedPlaylistTracks.clear();
+
     for(const auto &it : playlists) {
         if(!(it)) {
             continue;
@@ -215,14 +571,238 @@ void Cache::savePlaylists(const PlaylistList &playlists)
         s << qint32(it->sortColumn());
     }
 
-    QDataStream fs(&f);
-    fs << qint32(playlistListCacheVersion);
-    fs << qChecksum(data.data(), data.size());
+    // The paths of the tracks go in front, so that the tracks can be found
+    // even if their cache IDs changed by the time the playlists are loaded.
+
+    QByteArray data;
+    QDataStream ts(&data, QIODevice::WriteOnly);
+    ts.setVersion(QDataStream::Qt_4_3);
+
+    ts << quint32(cache->m_savedPlaylistTracks.count());
+    for(auto it = cache->m_savedPlaylistTracks.cbegin(); it != cache->m_savedPlaylistTracks.cend(); ++it)
+        ts << it.key() << it.value();
+
+    data += playlistData;
+    cache->m_savedPlaylistTracks.clear();
+
+    // Everything needed is in data now, checksum and write it out on the
+    // writer thread.
+
+    QtConcurrent::run(&cache->m_writer, [data]() {
+        QSaveFile f(playlistsCacheFileName());
+
+        if(!f.open(QIODevice::WriteOnly)) {
+            qCCritical(JUK_LOG) << "Error saving collection:" << f.errorString();
+            return;
+        }
+
+        QDataStream fs(&f);
+        fs << qint32(playlistListCacheVersion);
+        fs << qChecksum(data.constData(), data.size());
+
+        fs << data;
+
+        if(!f.commit())
+            qCCritical(JUK_LOG) << "Error saving collection:" << f.errorString();
+    });
+}
+
+void Cache::writePlaylistTracks(QDataStream &s, const PlaylistItemList &items)
+{
+    QVector<quint32> ids;
+    ids.reserve(items.count());
+
+    for(const auto &item : items) {
+        const FileHandle file = item->file();
+
+        // Only tracks restored from the cache while it's still loading can
+        // be without an ID, and the playlists aren't loaded by then.
+        if(file.cacheId() == 0) {
+            qCWarning(JUK_LOG) << "Dropping" << file.absFilePath()
+                               << "from a saved playlist as it has no cache ID";
+            continue;
+        }
+
+        ids << file.cacheId();
+        m_savedPlaylistTracks.insert(file.cacheId(), file.absFilePath());
+    }
+
+    s << ids;
+}
+
+FileHandleList Cache::readPlaylistTracks(QDataStream &s) const
+{
+    const CollectionList *collection = CollectionList::instance();
+    FileHandleList files;
+
+    if(m_loadingPlaylistsVersion < 4) {
+        QStringList paths;
+        s >> paths;
+
+        files.reserve(paths.count());
+
+        for(const auto &path : qAsConst(paths)) {
+            if(path.isEmpty())
+                throw BICStreamException();
+
+            // Reuse FileHandle so the playlist doesn't force TagLib to read it
+            // from disk
+            const auto item = collection->lookup(path);
+            files << (item ? item->file() : FileHandle(path));
+        }
+
+        return files;
+    }
+
+    QVector<quint32> ids;
+    s >> ids;
+
+    files.reserve(ids.count());
+
+    for(const auto id : qAsConst(ids)) {
+        const auto moved = m_movedPlaylistTracks.constFind(id);
+
+        if(moved != m_movedPlaylistTracks.cend()) {
+            files << *moved;
+        }
+        else if(const auto item = collection->lookupByCacheId(id)) {
+            files << item->file();
+        }
+        else {
+            qCWarning(JUK_LOG) << "Playlist refers to unknown track" << id;
+            files << FileHandle();
+        }
+    }
+
+    return files;
+}
+
+void Cache::saveCollection(const FileHandleList &files)
+{
+    // Nothing else writes the files once the writer thread is done.
+    waitForPendingWrites();
+
+    const quint32 generation = m_journalGeneration + 1;
+    if(!writeSnapshot(files, generation))
+        return;
 
-    fs << data;
+    // Everything in the journal is part of the new snapshot now.
+    QFile::remove(Journal::fileName());
 
-    if(!f.commit())
-        qCCritical(JUK_LOG) << "Error saving collection:" << f.errorString();
+    const qint64 snapshotSize = QFileInfo(fileHandleCacheFileName()).size();
+
+    QMutexLocker locker(&m_journalLock);
+
+    m_generation = m_journalGeneration = generation;
+    m_haveSnapshot = true;
+    m_journalDamaged = false;
+    m_journalSize = 0;
+    m_snapshotSize = snapshotSize;
+}
+
+void Cache::saveCollectionInBackground(const FileHandleList &files)
+{
+    if(m_backgroundSave.isRunning())
+        return;
+
+    // The tags may be edited on the GUI thread while the snapshot is being
+    // written, so give the worker its own copies.  The time the tag was read
+    // at is what's saved, and unlike lastModified() it doesn't need a stat().
+
+    FileHandleList snapshot;
+    snapshot.reserve(files.count());
+
+    for(const auto &file : files) {
+        FileHandle copy(file.absFilePath(), new Tag(*file.tag()), file.baseModificationTime());
+        copy.setCacheId(file.cacheId());
+        snapshot << copy;
+    }
+
+    // Changes journaled from now on aren't in the snapshot, so they need to
+    // be tagged with its generation to survive the compaction.
+
+    QMutexLocker locker(&m_journalLock);
+    const quint32 generation = ++m_journalGeneration;
+    locker.unlock();
+
+    m_backgroundSave = QtConcurrent::run(&m_writer, [this, snapshot, generation]() {
+        if(!writeSnapshot(snapshot, generation))
+            return;
+
+        const qint64 snapshotSize = QFileInfo(fileHandleCacheFileName()).size();
+        const qint64 journalSize = dropJournalBatchesBefore(generation);
+
+        QMutexLocker locker(&m_journalLock);
+
+        m_generation = generation;
+        m_haveSnapshot = true;
+        m_snapshotSize = snapshotSize;
+
+        if(journalSize >= 0) {
+            m_journalSize = journalSize;
+            m_journalDamaged = false;
+        }
+    });
+}
+
+bool Cache::appendToJournal(const FileHandleList &changed, const QStringList &removed)
+{
+    QMutexLocker locker(&m_journalLock);
+
+    if(!m_haveSnapshot || m_journalDamaged)
+        return false;
+
+    if(changed.isEmpty() && removed.isEmpty())
+        return true;
+
+    QByteArray batch;
+    QDataStream s(&batch, QIODevice::WriteOnly);
+    s.setVersion(QDataStream::Qt_4_3);
+
+    for(const auto &file : changed) {
+        const Tag *tag = file.tag();
+
+        s << quint8(Journal::Put) << file.absFilePath()
+          << tag->title() << tag->artist() << tag->album()
+          << tag->genre() << tag->comment()
+          << qint32(tag->track()) << qint32(tag->year())
+          << qint32(tag->seconds()) << qint32(tag->bitrate())
+          << qint64(file.baseModificationTime().toMSecsSinceEpoch())
+          << file.cacheId()
+          << MappedCache::recordFlags(tag);
+    }
+
+    for(const auto &path : removed)
+        s << quint8(Journal::Remove) << path;
+
+    const quint32 generation = m_journalGeneration;
+
+    QtConcurrent::run(&m_writer, [this, batch, generation]() {
+        writeJournalBatch(batch, generation);
+    });
+
+    return true;
+}
+
+bool Cache::journalNeedsCompaction() const
+{
+    if(m_backgroundSave.isRunning())
+        return false;
+
+    QMutexLocker locker(&m_journalLock);
+    return m_journalSize > qMax(Journal::minimumCompactionSize,
+                                m_snapshotSize / Journal::compactionRatio);
+}
+
+bool Cache::journalDamaged() const
+{
+    QMutexLocker locker(&m_journalLock);
+    return m_journalDamaged;
+}
+
+void Cache::waitForPendingWrites()
+{
+    m_writer.waitForDone();
 }
 
 void Cache::ensureAppDataStorageExists() // static
@@ -251,21 +831,19 @@ QString Cache::playlistsCacheFileName() // static
     return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/playlists";
 }
 
-////////////////////////////////////////////////////////////////////////////////
-// private methods
-////////////////////////////////////////////////////////////////////////////////
-
-Cache::Cache()
-{
-
-}
-
 bool Cache::prepareToLoadCachedItems()
 {
     m_loadFile.setFileName(fileHandleCacheFileName());
     if(!m_loadFile.open(QIODevice::ReadOnly))
         return false;
 
+    char versionBytes[4];
+    if(m_loadFile.peek(versionBytes, sizeof(versionBytes)) == sizeof(versionBytes) &&
+       qFromBigEndian<qint32>(versionBytes) >= 3)
+    {
+        return prepareToLoadMappedItems();
+    }
+
     m_loadDataStream.setDevice(&m_loadFile);
 
     int dataStreamVersion = CacheDataStream::Qt_3_3;
@@ -320,6 +898,163 @@ bool Cache::prepareToLoadCachedItems()
     return true;
 }
 
+int Cache::cachedSegmentCount() const
+{
+    // Tracks added or retagged since the snapshot are delivered as one more
+    // segment at the end.
+    if(m_loadMap)
+        return m_segmentCount + (m_journalTracks.isEmpty() ? 0 : 1);
+
+    // The older formats can only be read front to back.
+    return m_loadDataStream.device() ? 1 : 0;
+}
+
+FileHandleList Cache::loadCachedSegment(int segment)
+{
+    using namespace MappedCache;
+
+    FileHandleList files;
+
+    if(!m_loadMap) {
+        for(FileHandle file = loadNextCachedItem(); !file.isNull(); file = loadNextCachedItem())
+            files << file;
+        return files;
+    }
+
+    if(quint32(segment) == m_segmentCount)
+        return m_journalTracks;
+
+    if(segment < 0 || quint32(segment) > m_segmentCount)
+        return files;
+
+    const uchar *entry = m_loadMap + HeaderSize + segment * SegmentEntrySize;
+    const quint32 start = u32(entry + SegmentStart);
+    const quint32 recordCount = u32(entry + SegmentRecordCount);
+    const quint32 pathsSize = u32(entry + SegmentPathsSize);
+    const quint32 stringsSize = u32(entry + SegmentStringsSize);
+    const quint32 recordBytes = recordCount * m_recordSize;
+
+    const uchar *pathTable = m_loadMap + start;
+    const uchar *records = pathTable + pathsSize;
+
+    if(crc32c(pathTable, pathsSize) != u32(entry + SegmentPathsChecksum)) {
+        // Without the paths there's nothing to go on, the folder scan will
+        // have to pick up whatever tracks were lost here.
+        qCCritical(JUK_LOG) << "Music cache segment" << segment << "has corrupt paths,"
+                            << recordCount << "tracks are lost";
+        return files;
+    }
+
+    StringReader paths(pathTable, pathsSize);
+
+    if(crc32c(records, recordBytes + stringsSize) != u32(entry + SegmentChecksum)) {
+        qCCritical(JUK_LOG) << "Music cache segment" << segment << "is corrupt, reading its"
+                            << recordCount << "tracks again";
+        return reloadTracks(paths.strings());
+    }
+
+    StringReader strings(records + recordBytes, stringsSize);
+    files.reserve(int(recordCount));
+
+    for(quint32 i = 0; i < recordCount; ++i) {
+        const uchar *record = records + i * m_recordSize;
+
+        const QString path = paths.string(u32(record + RecordPath), false);
+        if(path.isEmpty()) {
+            qCCritical(JUK_LOG) << "Attempted to read file handle from corrupt cache file.";
+            break;
+        }
+
+        // Superseded by the journal
+        if(m_journalPaths.contains(path))
+            continue;
+
+        Tag *tag = new Tag(path, true);
+        tag->m_title   = strings.string(u32(record + RecordTitle), false);
+        tag->m_artist  = strings.string(u32(record + RecordArtist), true);
+        tag->m_album   = strings.string(u32(record + RecordAlbum), true);
+        tag->m_genre   = strings.string(u32(record + RecordGenre), true);
+#ifdef Q_OS_WIN
+        // A mapped file can't be replaced on Windows, so don't keep it around.
+        tag->m_comment = strings.string(u32(record + RecordComment), true);
+#else
+        const quint32 comment = u32(record + RecordComment);
+        if(comment != 0) {
+            tag->m_mappedComment = strings.entry(comment);
+            if(tag->m_mappedComment)
+                tag->m_commentMapping = m_mapping;
+        }
+#endif
+        tag->m_track   = qint32(u32(record + RecordTrack));
+        tag->m_year    = qint32(u32(record + RecordYear));
+        tag->setAudioProperties(qint32(u32(record + RecordSeconds)),
+                                qint32(u32(record + RecordBitrate)));
+        applyRecordFlags(tag, u32(record + RecordFlags));
+
+        const auto modified = QDateTime::fromMSecsSinceEpoch(
+                qFromLittleEndian<qint64>(record + RecordModified));
+
+        FileHandle file(path, tag, modified);
+        file.setCacheId(u32(record + RecordCacheId));
+        files << file;
+    }
+
+    return files;
+}
+
+void Cache::finishLoadingCachedItems()
+{
+    // Tags that haven't decoded their comments yet keep the mapping alive.
+    m_mapping.reset();
+    m_loadMap = nullptr;
+
+    m_segmentCount = 0;
+    m_journalPaths.clear();
+    m_journalTracks.clear();
+    m_loadDataStream.setDevice(0);
+    m_loadFileBuffer.close();
+    m_loadFileBuffer.setData(QByteArray());
+    m_loadFile.close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// private methods
+////////////////////////////////////////////////////////////////////////////////
+
+Cache::Cache()
+{
+    // One thread, so that the writes happen in the order they were made.
+    m_writer.setMaxThreadCount(1);
+}
+
+// Checks that the tracks the playlists refer to still have the same cache
+// IDs, which they won't if the collection cache was lost for instance.
+void Cache::readPlaylistTrackTable(QDataStream &s)
+{
+    const CollectionList *collection = CollectionList::instance();
+
+    quint32 count;
+    s >> count;
+
+    for(quint32 i = 0; i < count && s.status() == QDataStream::Ok; ++i) {
+        quint32 id;
+        QString path;
+        s >> id >> path;
+
+        const auto item = collection->lookupByCacheId(id);
+        if(item && item->file().absFilePath() == path)
+            continue;
+
+        const auto moved = collection->lookup(path);
+        m_movedPlaylistTracks.insert(id, moved ? moved->file() : FileHandle(path));
+    }
+
+    if(!m_movedPlaylistTracks.isEmpty()) {
+        qCWarning(JUK_LOG) << m_movedPlaylistTracks.count()
+                           << "tracks in playlists had to be found by path";
+    }
+}
+
 FileHandle Cache::loadNextCachedItem()
 {
     if(!m_loadFile.isOpen() || !m_loadDataStream.device()) {
@@ -347,4 +1082,402 @@ FileHandle Cache::loadNextCachedItem()
     }
 }
 
+// Reads the tracks at paths from the files themselves, for when their
+// metadata in the cache can't be trusted.
+FileHandleList Cache::reloadTracks(const QStringList &paths) const
+{
+    FileHandleList files;
+
+    for(const auto &path : paths) {
+        if(m_journalPaths.contains(path) || !QFile::exists(path))
+            continue;
+
+        FileHandle file(path);
+        file.tag(); // Read it here rather than on the GUI thread
+        files << file;
+    }
+
+    return files;
+}
+
+bool Cache::writeSnapshot(const FileHandleList &files, quint32 generation) // static
+{
+    using namespace MappedCache;
+
+    QSaveFile f(fileHandleCacheFileName());
+
+    if(!f.open(QIODevice::WriteOnly)) {
+        qCCritical(JUK_LOG) << "Error saving cache:" << f.errorString();
+        return false;
+    }
+
+    // Keep tracks from the same directory together so that the per-segment
+    // string tables can share album and artist names.
+
+    FileHandleList sorted(files);
+    std::sort(sorted.begin(), sorted.end(),
+        [](const FileHandle &a, const FileHandle &b) {
+            return a.absFilePath() < b.absFilePath();
+        });
+
+    const int segmentCount = (sorted.count() + tracksPerSegment - 1) / tracksPerSegment;
+    QByteArray header(HeaderSize + segmentCount * SegmentEntrySize, 0);
+    QVector<QByteArray> segments;
+    segments.reserve(2 * segmentCount);
+
+    qint64 segmentStart = header.size();
+
+    for(int segment = 0; segment < segmentCount; ++segment) {
+        const int first = segment * tracksPerSegment;
+        const int count = qMin(tracksPerSegment, sorted.count() - first);
+
+        StringTable paths;
+        StringTable strings;
+        QByteArray data(count * RecordSize, 0);
+        int offset = 0;
+
+        for(int i = first; i < first + count; ++i) {
+            const FileHandle &file = sorted[i];
+            const Tag *tag = file.tag();
+
+            putU32(data, offset + RecordPath,    paths.add(file.absFilePath()));
+            putU32(data, offset + RecordTitle,   strings.add(tag->title()));
+            putU32(data, offset + RecordArtist,  strings.add(tag->artist()));
+            putU32(data, offset + RecordAlbum,   strings.add(tag->album()));
+            putU32(data, offset + RecordGenre,   strings.add(tag->genre()));
+            putU32(data, offset + RecordComment, strings.add(tag->comment()));
+            putU32(data, offset + RecordTrack,   quint32(tag->track()));
+            putU32(data, offset + RecordYear,    quint32(tag->year()));
+            putU32(data, offset + RecordSeconds, quint32(tag->seconds()));
+            putU32(data, offset + RecordBitrate, quint32(tag->bitrate()));
+            putU32(data, offset + RecordFlags,   recordFlags(tag));
+            putU32(data, offset + RecordCacheId, file.cacheId());
+            qToLittleEndian<qint64>(file.baseModificationTime().toMSecsSinceEpoch(),
+                                    data.data() + offset + RecordModified);
+
+            offset += RecordSize;
+        }
+
+        data += strings.data();
+
+        const qint64 segmentSize = paths.data().size() + data.size();
+        if(segmentStart + segmentSize > std::numeric_limits<quint32>::max()) {
+            qCCritical(JUK_LOG) << "Collection too large to be cached";
+            f.cancelWriting();
+            return false;
+        }
+
+        const int entry = HeaderSize + segment * SegmentEntrySize;
+        putU32(header, entry + SegmentStart,         quint32(segmentStart));
+        putU32(header, entry + SegmentRecordCount,   quint32(count));
+        putU32(header, entry + SegmentPathsSize,     quint32(paths.data().size()));
+        putU32(header, entry + SegmentStringsSize,   quint32(strings.data().size()));
+        putU32(header, entry + SegmentPathsChecksum, crc32c(paths.data().constData(), paths.data().size()));
+        putU32(header, entry + SegmentChecksum,      crc32c(data.constData(), data.size()));
+
+        segmentStart += segmentSize;
+        segments << paths.data() << data;
+    }
+
+    qToBigEndian<qint32>(playlistItemsCacheVersion, header.data() + HeaderVersion);
+    putU32(header, HeaderMagic,        magic);
+    putU32(header, HeaderSegmentCount, quint32(segmentCount));
+    putU32(header, HeaderRecordSize,   RecordSize);
+    putU32(header, HeaderGeneration,   generation);
+    putU32(header, HeaderChecksum,     headerChecksum(header.constData(), header.size()));
+
+    f.write(header);
+    for(const auto &data : qAsConst(segments))
+        f.write(data);
+
+    if(!f.commit()) {
+        qCCritical(JUK_LOG) << "Error saving cache:" << f.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+bool Cache::prepareToLoadMappedItems()
+{
+    using namespace MappedCache;
+
+    m_loadFile.close();
+
+    auto mapping = std::make_shared<const CacheMapping>(fileHandleCacheFileName());
+    const uchar *map = mapping->data();
+    const qint64 size = mapping->size();
+
+    if(!map)
+        return false;
+
+    if(size < HeaderSize || size > std::numeric_limits<quint32>::max()) {
+        qCCritical(JUK_LOG) << "Music cache has an impossible size" << size;
+        return false;
+    }
+
+    const qint32 version = qFromBigEndian<qint32>(map + HeaderVersion);
+    const quint32 segmentCount = u32(map + HeaderSegmentCount);
+    const quint32 recordSize = u32(map + HeaderRecordSize);
+
+    const quint64 directoryEnd = quint64(HeaderSize) + quint64(segmentCount) * SegmentEntrySize;
+
+    // Version 5 only lacks the cache IDs, which are assigned anew.
+    if(version < 5 || version > playlistItemsCacheVersion || u32(map + HeaderMagic) != magic) {
+        qCCritical(JUK_LOG) << "Music cache version" << version << "is unsupported";
+        return false;
+    }
+
+    bool valid = recordSize >= RecordSize && directoryEnd <= quint64(size) &&
+                 headerChecksum(reinterpret_cast<const char *>(map), directoryEnd) ==
+                     u32(map + HeaderChecksum);
+
+    // Check that every segment lies within the file, so that the segments
+    // can later be decoded without any further bounds checks on the records.
+
+    for(quint32 segment = 0; valid && segment < segmentCount; ++segment) {
+        const uchar *entry = map + HeaderSize + segment * SegmentEntrySize;
+        const quint64 start = u32(entry + SegmentStart);
+        const quint64 pathsSize = u32(entry + SegmentPathsSize);
+        const quint64 recordBytes = quint64(u32(entry + SegmentRecordCount)) * recordSize;
+        const quint64 stringsSize = u32(entry + SegmentStringsSize);
+
+        valid = pathsSize >= 4 && stringsSize >= 4 &&
+                start + pathsSize + recordBytes + stringsSize <= quint64(size);
+    }
+
+    if(!valid) {
+        // Nothing in the cache can be found without the directory.
+        qCCritical(JUK_LOG) << "Music cache header is corrupt";
+        KMessageBox::error(0, i18n("The music data cache has been corrupted. JuK "
+                                   "needs to rescan it now. This may take some time."));
+        return false;
+    }
+
+    m_mapping = mapping;
+    m_loadMap = map;
+    m_segmentCount = segmentCount;
+    m_recordSize = recordSize;
+
+    QMutexLocker locker(&m_journalLock);
+
+    m_generation = m_journalGeneration = u32(map + HeaderGeneration);
+    m_haveSnapshot = true;
+    m_snapshotSize = size;
+
+    loadJournal();
+
+    return true;
+}
+
+// Runs on the writer thread.
+void Cache::writeJournalBatch(const QByteArray &batch, quint32 generation)
+{
+    // An earlier batch failed, so a snapshot has to save these changes.
+    {
+        QMutexLocker locker(&m_journalLock);
+        if(m_journalDamaged)
+            return;
+    }
+
+    // The lock isn't held while writing, as the GUI thread takes it too and
+    // would have to wait for the fsync.
+
+    QFile f(Journal::fileName());
+    const bool exists = f.exists();
+    bool written = false;
+
+    if(f.open(exists ? QIODevice::Append : QIODevice::WriteOnly)) {
+        QDataStream fs(&f);
+        fs.setVersion(QDataStream::Qt_4_3);
+
+        if(!exists)
+            Journal::writeHeader(fs);
+
+        Journal::writeBatch(fs, generation, batch);
+
+        written = Journal::syncToDisk(f) && f.error() == QFile::NoError;
+    }
+
+    QMutexLocker locker(&m_journalLock);
+
+    if(!written) {
+        // Whatever made it to disk may be cut off, don't add to it any further.
+        qCCritical(JUK_LOG) << "Error saving cache journal:" << f.errorString();
+        m_journalDamaged = true;
+        return;
+    }
+
+    m_journalSize = f.size();
+}
+
+void Cache::loadJournal()
+{
+    QFile f(Journal::fileName());
+    if(!f.open(QIODevice::ReadOnly))
+        return;
+
+    m_journalSize = f.size();
+
+    QDataStream s(&f);
+    s.setVersion(QDataStream::Qt_4_3);
+
+    qint32 version;
+    quint32 magic;
+    s >> version >> magic;
+
+    if(s.status() != QDataStream::Ok || version < Journal::oldestVersion ||
+       version > Journal::version || magic != Journal::magic)
+    {
+        qCCritical(JUK_LOG) << "Music cache journal is unsupported or corrupt, ignoring it";
+        m_journalDamaged = true;
+        return;
+    }
+
+    // Replay older journals but don't append to them.
+    if(version != Journal::version)
+        m_journalDamaged = true;
+
+    // Later entries for a path replace earlier ones.
+    QHash<QString, FileHandle> entries;
+
+    while(!s.atEnd()) {
+        quint32 generation;
+        QByteArray batch;
+
+        const auto status = Journal::readBatch(s, generation, batch);
+
+        if(status == Journal::BatchTruncated) {
+            qCWarning(JUK_LOG) << "Music cache journal is cut off, the last changes are lost";
+            m_journalDamaged = true;
+            break;
+        }
+
+        if(status == Journal::BatchCorrupt) {
+            qCWarning(JUK_LOG) << "Skipping a corrupt batch of changes in the music cache journal";
+            continue;
+        }
+
+        // A batch newer than the snapshot comes from a compaction that didn't
+        // finish.  Make sure that the next compaction gets past it.
+        m_journalGeneration = qMax(m_journalGeneration, generation);
+
+        if(generation >= m_generation)
+            readJournalBatch(batch, version, entries);
+    }
+
+    for(auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        m_journalPaths.insert(it.key());
+        if(!it->isNull())
+            m_journalTracks << *it;
+    }
+
+    qCDebug(JUK_LOG) << "Replayed" << entries.count() << "changes from the music cache journal";
+}
+
+void Cache::readJournalBatch(const QByteArray &batch, qint32 version,
+                             QHash<QString, FileHandle> &entries)
+{
+    QDataStream s(batch);
+    s.setVersion(QDataStream::Qt_4_3);
+
+    while(!s.atEnd()) {
+        quint8 type;
+        QString path;
+        s >> type >> path;
+
+        if(type == Journal::Remove) {
+            entries.insert(path, FileHandle());
+            continue;
+        }
+
+        if(type != Journal::Put) {
+            qCCritical(JUK_LOG) << "Unknown entry type" << type << "in the music cache journal";
+            return;
+        }
+
+        Tag *tag = new Tag(path, true);
+        qint32 track, year, seconds, bitrate;
+        qint64 modified;
+        quint32 cacheId = 0;
+        quint32 flags = 0;
+
+        s >> tag->m_title >> tag->m_artist >> tag->m_album
+          >> tag->m_genre >> tag->m_comment
+          >> track >> year >> seconds >> bitrate
+          >> modified;
+
+        if(version >= 3)
+            s >> cacheId;
+        if(version >= 4)
+            s >> flags;
+
+        if(s.status() != QDataStream::Ok) {
+            delete tag;
+            return;
+        }
+
+        tag->m_track = track;
+        tag->m_year = year;
+        tag->setAudioProperties(seconds, bitrate);
+        MappedCache::applyRecordFlags(tag, flags);
+
+        FileHandle file(path, tag, QDateTime::fromMSecsSinceEpoch(modified));
+        file.setCacheId(cacheId);
+        entries.insert(path, file);
+    }
+}
+
+// Rewrites the journal without the batches that are already part of the
+// snapshot with the given generation, on the writer thread.  Returns the size
+// of the journal left behind, or -1 if it couldn't be rewritten.
+qint64 Cache::dropJournalBatchesBefore(quint32 generation) // static
+{
+    QFile f(Journal::fileName());
+    if(!f.open(QIODevice::ReadOnly))
+        return 0;
+
+    QDataStream s(&f);
+    s.setVersion(QDataStream::Qt_4_3);
+
+    qint32 version;
+    quint32 magic;
+    s >> version >> magic;
+
+    QSaveFile out(Journal::fileName());
+    if(!out.open(QIODevice::WriteOnly)) {
+        qCCritical(JUK_LOG) << "Error compacting cache journal:" << out.errorString();
+        return -1;
+    }
+
+    QDataStream os(&out);
+    os.setVersion(QDataStream::Qt_4_3);
+    Journal::writeHeader(os);
+
+    // Anything unreadable is left behind, it can't be appended to anyway.
+
+    if(s.status() == QDataStream::Ok && version == Journal::version && magic == Journal::magic) {
+        while(!s.atEnd()) {
+            quint32 batchGeneration;
+            QByteArray batch;
+
+            const auto status = Journal::readBatch(s, batchGeneration, batch);
+
+            if(status == Journal::BatchTruncated)
+                break;
+            if(status == Journal::BatchOk && batchGeneration >= generation)
+                Journal::writeBatch(os, batchGeneration, batch);
+        }
+    }
+
+    f.close();
+
+    if(!out.commit()) {
+        qCCritical(JUK_LOG) << "Error compacting cache journal:" << out.errorString();
+        return -1;
+    }
+
+    return QFileInfo(Journal::fileName()).size();
+}
+
 // vim: set et sw=4 tw=0 sta:
@@ -20,14 +20,25 @@
 
 #include <QDataStream>
 #include <QFile>
+#include <QFuture>
 #include <QBuffer>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QThreadPool>
 #include <QVector>
 
+#include <memory>
+
+#include "filehandle.h"
+
 class Playlist;
 class PlaylistCollection;
-class FileHandle;
+class PlaylistItem;
 
 typedef QVector<Playlist *> PlaylistList;
+typedef QVector<PlaylistItem *> PlaylistItemList;
 
 /**
  * A simple QDataStream subclass that has an extra field to indicate the cache
@@ -48,34 +59,154 @@ private:
 };
 
 
+/**
+ * A memory-mapped collection cache file.  It's kept alive for as long as tags
+ * restored from it still refer to it, see Tag::comment().
+ */
+
+class CacheMapping
+{
+public:
+    explicit CacheMapping(const QString &fileName);
+    ~CacheMapping();
+
+    /**
+     * Returns the mapped file, or nullptr if it couldn't be mapped.
+     */
+    const uchar *data() const { return m_data; }
+    qint64 size() const { return m_size; }
+
+    /**
+     * Decodes the string table entry at \a entry.  The entry must already
+     * have been checked to be within the mapping.
+     */
+    static QString string(const uchar *entry);
+
+private:
+    Q_DISABLE_COPY(CacheMapping)
+
+    QFile m_file;
+    uchar *m_data = nullptr;
+    qint64 m_size = 0;
+};
+
+
 class Cache
 {
 public:
     static Cache *instance();
 
     static void loadPlaylists(PlaylistCollection *collection);
+
+    /**
+     * Serializes \a playlists and writes them out on the writer thread.
+     */
     static void savePlaylists(const PlaylistList &playlists);
 
+    /**
+     * Writes the tracks of \a items to the playlists cache by their cache IDs.
+     * Only valid while savePlaylists() is running.
+     */
+    void writePlaylistTracks(QDataStream &s, const PlaylistItemList &items);
+
+    /**
+     * Reads the tracks written by writePlaylistTracks(), or the list of paths
+     * that older versions of the playlists cache had instead.  Tracks that
+     * can't be found are returned as null FileHandles.  Only valid while
+     * loadPlaylists() is running.
+     */
+    FileHandleList readPlaylistTracks(QDataStream &s) const;
+
+    /**
+     * The version of the playlists cache being read by loadPlaylists().
+     */
+    int loadingPlaylistsVersion() const { return m_loadingPlaylistsVersion; }
+
+    /**
+     * Writes \a files out as a new snapshot of the collection cache, replacing
+     * the old snapshot and its journal.
+     */
+    void saveCollection(const FileHandleList &files);
+
+    /**
+     * Like saveCollection(), but the snapshot is written from a worker thread.
+     * Changes can keep being appended to the journal in the meantime.  Does
+     * nothing if a background save is already running.
+     */
+    void saveCollectionInBackground(const FileHandleList &files);
+
+    /**
+     * Records the tracks that were added, retagged or removed since the last
+     * save in the journal, which is cheap compared to writing a snapshot.
+     * Returns false if there's no snapshot for the journal to apply to, in
+     * which case saveCollection() must be used instead.
+     *
+     * The changes are written out and synced on the writer thread.  If that
+     * fails journalDamaged() turns true and only a snapshot can save them.
+     */
+    bool appendToJournal(const FileHandleList &changed, const QStringList &removed);
+
+    /**
+     * Returns true if the journal has grown large enough relative to the
+     * snapshot that a new snapshot should be written.
+     */
+    bool journalNeedsCompaction() const;
+
+    bool journalDamaged() const;
+
+    /**
+     * Waits for the journal appends, snapshots and playlist saves that are
+     * still queued up on the writer thread.
+     */
+    void waitForPendingWrites();
+
     static void ensureAppDataStorageExists();
     static bool cacheFileExists();
 
     static QString fileHandleCacheFileName();
     static QString playlistsCacheFileName();
 
+    /**
+     * Opens the collection cache for reading.  Returns false if there's no
+     * usable cache.  finishLoadingCachedItems() must be called once loading is
+     * done either way.
+     */
     bool prepareToLoadCachedItems();
-    FileHandle loadNextCachedItem();
+
+    /**
+     * Returns the number of independently decodable segments in the cache
+     * opened by prepareToLoadCachedItems().
+     */
+    int cachedSegmentCount() const;
+
+    /**
+     * Decodes the tracks in \a segment.  Different segments may be decoded
+     * concurrently from worker threads, but each segment only once.
+     */
+    FileHandleList loadCachedSegment(int segment);
+
+    void finishLoadingCachedItems();
 
     /**
      * QDataStream version for serialized list of playlists
      * 1, 2: Who knows?
-     * 3: Current.
+     * 3: Tracks listed by path.
+     * 4: Tracks listed by FileHandle::cacheId(), with a table of the paths
+     *    of the tracks referred to in front of the playlists.
      */
     static const int playlistListCacheVersion;
 
     /**
-     * QDataStream version for serialized list of playlist items in a playlist
+     * Version for the collection cache of playlist items
      * 1: Original cache version
      * 2: KDE 4.0.1+, explicitly sets QDataStream encoding.
+     * 3: Memory-mapped, fixed-width track records and a shared string table
+     *    instead of a QDataStream blob.
+     * 4: Records and string tables split into independently decodable
+     *    segments, plus a journal of the changes since the snapshot.
+     * 5: CRC-32C checksums, with the paths checked separately from the rest
+     *    of each segment.
+     * 6: Persistent track IDs, see FileHandle::cacheId().
      */
     static const int playlistItemsCacheVersion;
 
@@ -83,10 +214,56 @@ private:
     // private to force access through instance()
     Cache();
 
+    bool prepareToLoadMappedItems();
+    FileHandle loadNextCachedItem();
+
+    FileHandleList reloadTracks(const QStringList &paths) const;
+
+    void readPlaylistTrackTable(QDataStream &s);
+
+    static bool writeSnapshot(const FileHandleList &files, quint32 generation);
+    void writeJournalBatch(const QByteArray &batch, quint32 generation);
+    void loadJournal();
+    void readJournalBatch(const QByteArray &batch, qint32 version,
+                          QHash<QString, FileHandle> &entries);
+    static qint64 dropJournalBatchesBefore(quint32 generation);
+
 private:
+    // The playlists cache refers to tracks by their cache IDs.  These track
+    // the paths of the tracks that were referred to while saving, and the
+    // tracks whose IDs changed in the meantime while loading.
+    QMap<quint32, QString> m_savedPlaylistTracks;
+    QHash<quint32, FileHandle> m_movedPlaylistTracks;
+    int m_loadingPlaylistsVersion = 0;
+
     QFile m_loadFile;
     QBuffer m_loadFileBuffer;
     CacheDataStream m_loadDataStream;
+
+    // Used for the memory-mapped cache format
+    std::shared_ptr<const CacheMapping> m_mapping;
+    const uchar *m_loadMap = nullptr;
+    quint32 m_segmentCount = 0;
+    quint32 m_recordSize = 0;
+
+    // Journal contents replayed on top of the snapshot while loading
+    QSet<QString> m_journalPaths;
+    FileHandleList m_journalTracks;
+
+    // Guards the snapshot state below, which the writer thread updates.  The
+    // files themselves are only written from that thread, so it doesn't
+    // hold the lock while writing.
+    mutable QMutex m_journalLock;
+    quint32 m_generation = 0;        // Of the snapshot on disk
+    quint32 m_journalGeneration = 0; // Tagged onto newly journaled changes
+    bool m_haveSnapshot = false;
+    bool m_journalDamaged = false;
+    qint64 m_snapshotSize = 0;
+    qint64 m_journalSize = 0;
+    QFuture<void> m_backgroundSave;
+
+    // All cache files are written from this pool's only thread.
+    QThreadPool m_writer;
 };
 
 #endif
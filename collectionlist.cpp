@@ -32,17 +32,28 @@
 #include <QList>
 #include <QMenu>
 #include <QReadLocker>
-#include <QSaveFile>
 #include <QTime>
+#include <QThread>
+#include <QThreadPool>
 #include <QTimer>
 #include <QWriteLocker>
+#include <QtConcurrent>
+
+#include <numeric>
+
+#include <audioproperties.h>
+#include <tfile.h>
 
 #include "playlistcollection.h"
 #include "stringshare.h"
+#include "searchkernel.h"
 #include "cache.h"
+#include "directoryindex.h"
 #include "actioncollection.h"
 #include "juktag.h"
+#include "mediaprobe.h"
 #include "viewmode.h"
+#include "startuptimeline.h"
 #include "juk_debug.h"
 
 using ActionCollection::action;
@@ -58,7 +69,25 @@ CollectionList *CollectionList::instance()
     return m_list;
 }
 
-static QElapsedTimer stopwatch;
+// Run on the QtConcurrent thread pool.
+static FileHandleList loadCachedSegment(int segment)
+{
+    return Cache::instance()->loadCachedSegment(segment);
+}
+
+// A single thread of its own for refining the audio properties, so that the
+// pass never holds up the threads that readers of the collection are
+// waiting for.
+static QThreadPool *refinePool()
+{
+    static QThreadPool *pool = [] {
+        auto pool = new QThreadPool;
+        pool->setMaxThreadCount(1);
+        return pool;
+    }();
+
+    return pool;
+}
 
 void CollectionList::startLoadingCachedItems()
 {
@@ -66,53 +95,114 @@ void CollectionList::startLoadingCachedItems()
         return;
 
     qCDebug(JUK_LOG) << "Starting to load cached items";
-    stopwatch.start();
 
-    if(!Cache::instance()->prepareToLoadCachedItems()) {
+    StartupTimeline *timeline = StartupTimeline::instance();
+    timeline->begin(StartupTimeline::CacheLoad);
+    timeline->begin(StartupTimeline::ItemInsertion);
+
+    Cache *cache = Cache::instance();
+
+    if(!cache->prepareToLoadCachedItems()) {
         qCCritical(JUK_LOG) << "Unable to setup to load cache... perhaps it doesn't exist?";
 
+        timeline->end(StartupTimeline::CacheLoad);
         completedLoadingCachedItems();
         return;
     }
 
-    QTimer::singleShot(0, this, &CollectionList::loadNextBatchCachedItems);
+    QVector<int> segments(cache->cachedSegmentCount());
+    std::iota(segments.begin(), segments.end(), 0);
+
+    qCDebug(JUK_LOG) << "Decoding" << segments.count() << "cache segments";
+
+    m_cacheLoadWatcher = new QFutureWatcher<FileHandleList>(this);
+
+    connect(m_cacheLoadWatcher, &QFutureWatcher<FileHandleList>::resultReadyAt,
+            this, [this](int index) {
+                const FileHandleList segment = m_cacheLoadWatcher->resultAt(index);
+                StartupTimeline::instance()->addItems(StartupTimeline::CacheLoad, segment.count());
+                m_cachedItemsToInsert += segment;
+                scheduleCachedItemInsertion();
+            });
+    connect(m_cacheLoadWatcher, &QFutureWatcher<FileHandleList>::finished,
+            this, [this] {
+                StartupTimeline::instance()->end(StartupTimeline::CacheLoad);
+                scheduleCachedItemInsertion();
+            });
+
+    m_cacheLoadWatcher->setFuture(QtConcurrent::mapped(segments, loadCachedSegment));
 }
 
 void CollectionList::loadNextBatchCachedItems()
 {
-    Cache *cache = Cache::instance();
-    bool done = false;
+    m_cachedItemInsertionScheduled = false;
 
-    QReadLocker lock(&m_itemsDictLock);
+    // Insert items for a bounded amount of time and then go back to the event
+    // loop, so that loading the music doesn't freeze the GUI.
 
-    for(int i = 0; i < 127; ++i) {
-        FileHandle cachedItem(cache->loadNextCachedItem());
+    QElapsedTimer batchTimer;
+    batchTimer.start();
 
-        if(cachedItem.isNull()) {
-            done = true;
-            break;
-        }
+    int inserted = 0;
+    QReadLocker lock(&m_itemsDictLock);
+
+    while(m_nextCachedItem < m_cachedItemsToInsert.count() && batchTimer.elapsed() < 20) {
+        const FileHandle cachedItem = m_cachedItemsToInsert.at(m_nextCachedItem++);
 
         // This may have already been created via a loaded playlist.
         if(!m_itemsDict.contains(cachedItem.absFilePath())) {
             lock.unlock();
+            m_insertingCachedItem = true;
             CollectionListItem *newItem = new CollectionListItem(this, cachedItem);
+            m_insertingCachedItem = false;
             lock.relock();
 
             setupItem(newItem);
+            ++inserted;
         }
     }
 
-    if(!done) {
-        QTimer::singleShot(0, this, &CollectionList::loadNextBatchCachedItems);
+    lock.unlock();
+
+    StartupTimeline::instance()->addItems(StartupTimeline::ItemInsertion, inserted);
+
+    if(m_nextCachedItem < m_cachedItemsToInsert.count()) {
+        scheduleCachedItemInsertion();
+        return;
     }
-    else {
+
+    // Caught up with the decoders, drop the inserted handles.
+    m_cachedItemsToInsert.clear();
+    m_nextCachedItem = 0;
+
+    if(m_cacheLoadWatcher->isFinished()) {
+        m_cacheLoadWatcher->deleteLater();
+        m_cacheLoadWatcher = nullptr;
+
         completedLoadingCachedItems();
     }
 }
 
+void CollectionList::scheduleCachedItemInsertion()
+{
+    if(m_cachedItemInsertionScheduled)
+        return;
+
+    m_cachedItemInsertionScheduled = true;
+    QTimer::singleShot(0, this, &CollectionList::loadNextBatchCachedItems);
+}
+
 void CollectionList::completedLoadingCachedItems()
 {
+    Cache::instance()->finishLoadingCachedItems();
+
+    for(auto item : qAsConst(m_itemsWithoutCacheId))
+        assignCacheId(item);
+    m_itemsWithoutCacheId.clear();
+
+    StartupTimeline *timeline = StartupTimeline::instance();
+    timeline->end(StartupTimeline::ItemInsertion);
+
     // The CollectionList is created with sorting disabled for speed.  Re-enable
     // it here, and perform the sort.
     KConfigGroup config(KSharedConfig::openConfig(), "Playlists");
@@ -121,9 +211,10 @@ void CollectionList::completedLoadingCachedItems()
     if(config.readEntry("CollectionListSortAscending", true))
         order = Qt::AscendingOrder;
 
+    timeline->begin(StartupTimeline::Sort);
     m_list->sortByColumn(config.readEntry("CollectionListSortColumn", 1), order);
+    timeline->end(StartupTimeline::Sort, m_itemsDict.size());
 
-    qCDebug(JUK_LOG) << "Finished loading cached items, took" << stopwatch.elapsed() << "ms";
     qCDebug(JUK_LOG) << m_itemsDict.size() << "items are in the CollectionList";
     qCDebug(JUK_LOG) << StringShare::numHits() << "string intern hits out of" << StringShare::numAttempts() << "attempts";
 
@@ -197,80 +288,86 @@ void CollectionList::setupTreeViewEntries(ViewMode *viewMode) const
         treeViewMode->addItems(m_columnTags[column]->keys(), column);
 }
 
-void CollectionList::slotNewItems(const KFileItemList &items)
+void CollectionList::slotFilesChanged(const QStringList &changed, const QStringList &removed)
 {
-    QStringList files;
+    for(const auto &file : removed)
+        delete lookup(file);
 
-    for(KFileItemList::ConstIterator it = items.constBegin(); it != items.constEnd(); ++it)
-        files.append((*it).url().path());
+    QStringList added;
 
-    addFiles(files);
-    update();
-}
+    for(const auto &file : changed) {
+        CollectionListItem *item = lookup(file);
 
-void CollectionList::slotRefreshItems(const QList<QPair<KFileItem, KFileItem> > &items)
-{
-    for(int i = 0; i < items.count(); ++i) {
-        const KFileItem fileItem = items[i].second;
-        CollectionListItem *item = lookup(fileItem.url().path());
+        if(!item) {
+            added << file;
+            continue;
+        }
 
-        if(item) {
-            item->refreshFromDisk();
+        item->refreshFromDisk();
 
-            // If the item is no longer on disk, remove it from the collection.
+        // If the item is no longer on disk, remove it from the collection.
 
-            if(item->file().fileInfo().exists())
-                item->repaint();
-            else
-                delete item;
-        }
+        if(item->file().fileInfo().exists())
+            item->repaint();
+        else
+            delete item;
     }
 
+    if(!added.isEmpty())
+        addFiles(added);
+
     update();
 }
 
-void CollectionList::slotDeleteItems(const KFileItemList &items)
+void CollectionList::slotDirectoriesChanged(const QStringList &directories)
 {
-    for(const auto &item : items) {
-        delete lookup(item.url().path());
+    // New tracks are found by scanning again, changed and removed ones by
+    // checking the tracks already in those directories.
+
+    QStringList existing;
+    for(const auto &directory : directories) {
+        if(QFileInfo(directory).isDir())
+            existing << directory;
     }
+
+    if(!existing.isEmpty())
+        addFiles(existing);
+
+    checkConsistency(directories);
 }
 
-void CollectionList::saveItemsToCache() const
+void CollectionList::saveItemsToCache()
 {
     qCDebug(JUK_LOG) << "Saving collection list to cache";
 
-    QSaveFile f(Cache::fileHandleCacheFileName());
+    m_saveTimer->stop();
+    saveChanges(false);
 
-    if(!f.open(QIODevice::WriteOnly)) {
-        qCCritical(JUK_LOG) << "Error saving cache:" << f.errorString();
-        return;
-    }
+    Cache *cache = Cache::instance();
+    cache->waitForPendingWrites();
 
-    QByteArray data;
-    QDataStream s(&data, QIODevice::WriteOnly);
-    s.setVersion(QDataStream::Qt_4_3);
+    // The journal write failed on the writer thread, save everything again.
+    if(cache->journalDamaged())
+        saveChanges(false);
 
-    { // locked scope
-        QHash<QString, CollectionListItem *>::const_iterator it;
-        QWriteLocker lock(&m_itemsDictLock);
-
-        for(it = m_itemsDict.begin(); it != m_itemsDict.end(); ++it) {
-            s << it.key();
-            s << (*it)->file();
-        }
+    // Quitting in the middle of a scan, keep what has been listed so far.
+    if(m_checkpointTimer->isActive()) {
+        m_checkpointTimer->stop();
+        DirectoryIndex::instance()->save(m_scannedFolders);
     }
+}
 
-    QDataStream fs(&f);
-
-    qint32 checksum = qChecksum(data.data(), data.size());
+void CollectionList::startScanCheckpoints(const QStringList &folders)
+{
+    m_scannedFolders = folders;
 
-    fs << qint32(Cache::playlistItemsCacheVersion)
-       << checksum
-       << data;
+    if(!m_checkpointTimer->isActive())
+        m_checkpointTimer->start();
+}
 
-    if(!f.commit())
-        qCCritical(JUK_LOG) << "Error saving cache:" << f.errorString();
+void CollectionList::stopScanCheckpoints()
+{
+    m_checkpointTimer->stop();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -293,22 +390,7 @@ void CollectionList::clear()
 
 void CollectionList::slotCheckCache()
 {
-    PlaylistItemList invalidItems;
-    qCDebug(JUK_LOG) << "Starting to check cached items for consistency";
-    stopwatch.start();
-
-    { // locked scope
-        QWriteLocker lock(&m_itemsDictLock);
-
-        for(auto item : qAsConst(m_itemsDict)) {
-            if(!item->checkCurrent())
-                invalidItems.append(item);
-        }
-    }
-
-    clearItems(invalidItems);
-
-    qCDebug(JUK_LOG) << "Finished consistency check, took" << stopwatch.elapsed() << "ms";
+    checkConsistency(QStringList());
 }
 
 void CollectionList::slotRemoveItem(const QString &file)
@@ -348,10 +430,41 @@ CollectionList::CollectionList(PlaylistCollection *collection) :
 
     // Even set to true it wouldn't work with this class due to other checks
     setAllowDuplicates(false);
+
+    // Save changes to the cache a while after they happen, so that
+    // bursts of changes end up together in the journal.
+    m_saveTimer = new QTimer(this);
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(60 * 1000);
+    connect(m_saveTimer, &QTimer::timeout, this, &CollectionList::slotSaveChanges);
+
+    m_checkpointTimer = new QTimer(this);
+    m_checkpointTimer->setInterval(30 * 1000);
+    connect(m_checkpointTimer, &QTimer::timeout, this, &CollectionList::slotCheckpointScan);
+
+    m_refineTimer = new QTimer(this);
+    m_refineTimer->setSingleShot(true);
+    m_refineTimer->setInterval(5 * 1000);
+    connect(m_refineTimer, &QTimer::timeout, this, &CollectionList::slotRefineAudioProperties);
 }
 
 CollectionList::~CollectionList()
 {
+    // Don't pull the cache mapping out from under the decoders.
+    if(m_cacheLoadWatcher) {
+        m_cacheLoadWatcher->cancel();
+        m_cacheLoadWatcher->waitForFinished();
+        Cache::instance()->finishLoadingCachedItems();
+    }
+
+    if(m_consistencyCheckWatcher) {
+        m_consistencyCheckWatcher->cancel();
+        m_consistencyCheckWatcher->waitForFinished();
+    }
+
+    if(m_refineWatcher)
+        m_refineWatcher->waitForFinished();
+
     KConfigGroup config(KSharedConfig::openConfig(), "Playlists");
     config.writeEntry("CollectionListSortColumn", header()->sortIndicatorSection());
     config.writeEntry("CollectionListSortAscending", header()->sortIndicatorOrder() == Qt::AscendingOrder);
@@ -384,14 +497,97 @@ void CollectionList::dragMoveEvent(QDragMoveEvent *e)
 
 void CollectionList::addToDict(const QString &file, CollectionListItem *item)
 {
-    QWriteLocker lock(&m_itemsDictLock);
-    m_itemsDict.insert(file, item);
+    {
+        QWriteLocker lock(&m_itemsDictLock);
+        if(!m_itemsDict.contains(file))
+            ++m_directoryItemCounts[DirectoryIndex::directoryOf(file)];
+
+        m_itemsDict.insert(file, item);
+    }
+
+    markChanged(file);
 }
 
 void CollectionList::removeFromDict(const QString &file)
 {
+    {
+        QWriteLocker lock(&m_itemsDictLock);
+
+        if(m_itemsDict.remove(file) > 0) {
+            const QString directory = DirectoryIndex::directoryOf(file);
+            if(--m_directoryItemCounts[directory] <= 0)
+                m_directoryItemCounts.remove(directory);
+        }
+    }
+
+    markChanged(file);
+}
+
+void CollectionList::assignCacheId(CollectionListItem *item)
+{
+    // Anything larger comes from a damaged cache.
+    static const quint32 maximumCacheId = 1 << 26;
+
+    FileHandle file = item->file();
+    quint32 id = file.cacheId();
+
+    const bool usable = id != 0 && id < maximumCacheId &&
+        (id >= quint32(m_itemsByCacheId.size()) || !m_itemsByCacheId[id]);
+
+    if(!usable) {
+        file.setCacheId(0);
+
+        if(m_cacheLoadWatcher) {
+            m_itemsWithoutCacheId.append(item);
+            return;
+        }
+
+        id = qMax(1, m_itemsByCacheId.size());
+    }
+
+    if(id >= quint32(m_itemsByCacheId.size()))
+        m_itemsByCacheId.resize(id + 1);
+
+    m_itemsByCacheId[id] = item;
+    file.setCacheId(id);
+}
+
+void CollectionList::releaseCacheId(CollectionListItem *item)
+{
+    const quint32 id = item->file().cacheId();
+
+    if(id < quint32(m_itemsByCacheId.size()) && m_itemsByCacheId[id] == item)
+        m_itemsByCacheId[id] = nullptr;
+    else if(id == 0)
+        m_itemsWithoutCacheId.removeOne(item);
+}
+
+void CollectionList::markChanged(const QString &file)
+{
+    // Items from the cache are already saved in it.
+    if(m_insertingCachedItem)
+        return;
+
     QWriteLocker lock(&m_itemsDictLock);
-    m_itemsDict.remove(file);
+    m_changedPaths.insert(file);
+    lock.unlock();
+
+    if(!m_saveTimer->isActive())
+        m_saveTimer->start();
+}
+
+void CollectionList::refineAudioProperties(const FileHandle &file)
+{
+    // Items are refreshed a lot, only queue each track once.
+    const QString path = file.absFilePath();
+    if(m_queuedTracksToRefine.contains(path))
+        return;
+
+    m_queuedTracksToRefine.insert(path);
+    m_tracksToRefine.append(path);
+
+    if(!m_refineWatcher && !m_refineTimer->isActive())
+        m_refineTimer->start();
 }
 
 bool CollectionList::hasItem(const QString &file) const
@@ -406,6 +602,42 @@ CollectionListItem *CollectionList::lookup(const QString &file) const
     return m_itemsDict.value(file, nullptr);
 }
 
+FileHandle CollectionList::lookupFile(const QString &file) const
+{
+    QReadLocker lock(&m_itemsDictLock);
+    const CollectionListItem *item = m_itemsDict.value(file, nullptr);
+    return item ? item->file() : FileHandle();
+}
+
+CollectionListItem *CollectionList::lookupByCacheId(quint32 cacheId) const
+{
+    if(cacheId >= quint32(m_itemsByCacheId.size()))
+        return nullptr;
+
+    return m_itemsByCacheId[cacheId];
+}
+
+int CollectionList::itemCountInDirectory(const QString &directory) const
+{
+    QReadLocker lock(&m_itemsDictLock);
+    return m_directoryItemCounts.value(directory);
+}
+
+const SearchIndex &CollectionList::searchIndex()
+{
+    if(!m_searchIndex.isBuilt()) {
+        QVector<CollectionListItem *> items;
+        items.reserve(topLevelItemCount());
+
+        for(int i = 0; i < topLevelItemCount(); ++i)
+            items.append(static_cast<CollectionListItem *>(topLevelItem(i)));
+
+        m_searchIndex.build(items);
+    }
+
+    return m_searchIndex;
+}
+
 QString CollectionList::addStringToDict(const QString &value, int column)
 {
     if(column > m_columnTags.count() || value.trimmed().isEmpty())
@@ -469,12 +701,319 @@ void CollectionList::removeWatched(const QString &file)
     m_dirWatch->removeFile(file);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// private methods
+////////////////////////////////////////////////////////////////////////////////
+
+void CollectionList::slotSaveChanges()
+{
+    saveChanges(true);
+}
+
+void CollectionList::slotCheckpointScan()
+{
+    qCDebug(JUK_LOG) << "Checkpointing the folder scan at" << count() << "tracks";
+
+    // The tracks read so far go to the cache journal and the directories
+    // listed so far to the directory index.  An index entry is only used
+    // while its directory still holds as many tracks as it did, so entries
+    // for directories whose tracks didn't make it into the journal just get
+    // scanned again.
+    m_saveTimer->stop();
+    saveChanges(true);
+
+    const QStringList folders = m_scannedFolders;
+    QtConcurrent::run([folders] {
+        DirectoryIndex::instance()->save(folders);
+    });
+}
+
+void CollectionList::slotRefineAudioProperties()
+{
+    static const int batchSize = 32;
+
+    if(m_refineWatcher || m_tracksToRefine.isEmpty())
+        return;
+
+    // The accurate reads can take a lot of I/O, so stay out of the way of
+    // loading and scanning the collection.
+    if(m_cacheLoadWatcher || m_consistencyCheckWatcher || m_checkpointTimer->isActive()) {
+        m_refineTimer->start();
+        return;
+    }
+
+    // The tracks are looked up again, as they may have been removed,
+    // refreshed or refined since they were queued.
+
+    FileHandleList batch;
+
+    while(batch.count() < batchSize && !m_tracksToRefine.isEmpty()) {
+        const QString path = m_tracksToRefine.takeFirst();
+        m_queuedTracksToRefine.remove(path);
+
+        const CollectionListItem *item = lookup(path);
+        if(item && item->file().tag() && item->file().tag()->propertiesEstimated())
+            batch << item->file();
+    }
+
+    if(batch.isEmpty())
+        return;
+
+    m_refineWatcher = new QFutureWatcher<QVector<RefinedTrack>>(this);
+
+    connect(m_refineWatcher, &QFutureWatcher<QVector<RefinedTrack>>::finished, this, [this] {
+        applyAccurateProperties(m_refineWatcher->result());
+
+        m_refineWatcher->deleteLater();
+        m_refineWatcher = nullptr;
+
+        if(!m_tracksToRefine.isEmpty())
+            QTimer::singleShot(0, this, &CollectionList::slotRefineAudioProperties);
+    });
+
+    m_refineWatcher->setFuture(QtConcurrent::run(refinePool(), [batch] {
+        return readAccurateProperties(batch);
+    }));
+}
+
+void CollectionList::saveChanges(bool inBackground)
+{
+    // Saving a snapshot of a partly loaded collection would lose tracks.
+    const bool loading = m_cacheLoadWatcher != nullptr;
+    Cache *cache = Cache::instance();
+
+    FileHandleList changed;
+    QStringList removed;
+    FileHandleList files;
+
+    { // locked scope
+        QWriteLocker lock(&m_itemsDictLock);
+
+        for(const auto &path : qAsConst(m_changedPaths)) {
+            CollectionListItem *item = m_itemsDict.value(path);
+            if(item)
+                changed << item->file();
+            else
+                removed << path;
+        }
+
+        m_changedPaths.clear();
+
+        if(!loading && cache->journalNeedsCompaction()) {
+            files.reserve(m_itemsDict.size());
+            for(const auto &item : qAsConst(m_itemsDict))
+                files.append(item->file());
+        }
+    }
+
+    if(cache->appendToJournal(changed, removed)) {
+        if(files.isEmpty())
+            return;
+    }
+    else if(loading) {
+        qCWarning(JUK_LOG) << "Unable to save" << changed.count() + removed.count()
+                           << "changes while the collection is still loading";
+        return;
+    }
+    else if(files.isEmpty()) {
+        QReadLocker lock(&m_itemsDictLock);
+
+        files.reserve(m_itemsDict.size());
+        for(const auto &item : qAsConst(m_itemsDict))
+            files.append(item->file());
+    }
+
+    qCDebug(JUK_LOG) << "Writing a new snapshot of" << files.count() << "tracks to the cache";
+
+    if(inBackground)
+        cache->saveCollectionInBackground(files);
+    else
+        cache->saveCollection(files);
+}
+
+void CollectionList::checkConsistency(const QStringList &directories)
+{
+    static const int batchSize = 256;
+
+    const bool fullCheck = directories.isEmpty();
+
+    // Only one check at a time, a partial one waits for the running check.
+    if(m_consistencyCheckWatcher) {
+        if(!fullCheck)
+            m_directoriesToCheck += directories;
+        return;
+    }
+
+    if(fullCheck) {
+        qCDebug(JUK_LOG) << "Starting to check cached items for consistency";
+        StartupTimeline::instance()->begin(StartupTimeline::ConsistencyCheck);
+    }
+
+    const auto isInDirectories = [&directories](const QString &file) {
+        for(const auto &directory : directories) {
+            if(file.length() > directory.length() && file.startsWith(directory) &&
+               file.at(directory.length()) == QLatin1Char('/'))
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // Only the snapshot is taken under the lock, the stat() calls (which can
+    // be very slow on network storage) happen on worker threads.
+
+    QVector<QVector<CheckedTrack>> batches;
+    int checked = 0;
+
+    { // locked scope
+        QReadLocker lock(&m_itemsDictLock);
+
+        if(directories.isEmpty())
+            batches.reserve(m_itemsDict.size() / batchSize + 1);
+
+        for(auto it = m_itemsDict.cbegin(); it != m_itemsDict.cend(); ++it) {
+            if(!directories.isEmpty() && !isInDirectories(it.key()))
+                continue;
+
+            if(batches.isEmpty() || batches.last().count() >= batchSize) {
+                batches.append(QVector<CheckedTrack>());
+                batches.last().reserve(batchSize);
+            }
+
+            const FileHandle file = it.value()->file();
+            batches.last().append({ file, it.key(), file.baseModificationTime() });
+            ++checked;
+        }
+    }
+
+    if(fullCheck)
+        StartupTimeline::instance()->addItems(StartupTimeline::ConsistencyCheck, checked);
+
+    m_consistencyCheckWatcher = new QFutureWatcher<ConsistencyDiff>(this);
+
+    connect(m_consistencyCheckWatcher, &QFutureWatcher<ConsistencyDiff>::resultReadyAt,
+            this, [this](int index) {
+                applyConsistencyDiff(m_consistencyCheckWatcher->resultAt(index));
+            });
+    connect(m_consistencyCheckWatcher, &QFutureWatcher<ConsistencyDiff>::finished,
+            this, [this, fullCheck] {
+                m_consistencyCheckWatcher->deleteLater();
+                m_consistencyCheckWatcher = nullptr;
+
+                if(fullCheck)
+                    StartupTimeline::instance()->end(StartupTimeline::ConsistencyCheck);
+
+                if(!m_directoriesToCheck.isEmpty()) {
+                    const QStringList directories = m_directoriesToCheck;
+                    m_directoriesToCheck.clear();
+                    checkConsistency(directories);
+                }
+            });
+
+    m_consistencyCheckWatcher->setFuture(QtConcurrent::mapped(batches, &CollectionList::checkTracks));
+}
+
+// Run on the QtConcurrent thread pool.
+CollectionList::ConsistencyDiff CollectionList::checkTracks(const QVector<CheckedTrack> &tracks) // static
+{
+    ConsistencyDiff diff;
+
+    for(const auto &track : tracks) {
+        const QFileInfo fileInfo(track.path);
+
+        if(!fileInfo.isFile()) {
+            diff.missing.append(track.file);
+            continue;
+        }
+
+        const QDateTime modified = fileInfo.lastModified();
+        if(track.modified.isValid() && modified.isValid() && track.modified >= modified)
+            continue;
+
+        // Read the new tag here rather than on the GUI thread.
+        FileHandle reread(fileInfo);
+        reread.tag();
+
+        diff.changed.append(qMakePair(track.file, reread));
+    }
+
+    return diff;
+}
+
+void CollectionList::applyConsistencyDiff(const ConsistencyDiff &diff)
+{
+    // Skip items that were removed or refreshed since the check started.
+
+    PlaylistItemList invalidItems;
+
+    for(const auto &file : diff.missing) {
+        CollectionListItem *item = lookup(file.absFilePath());
+        if(item && item->file() == file)
+            invalidItems.append(item);
+    }
+
+    if(!invalidItems.isEmpty())
+        clearItems(invalidItems);
+
+    for(const auto &change : diff.changed) {
+        CollectionListItem *item = lookup(change.first.absFilePath());
+        if(item && item->file() == change.first)
+            item->setFile(change.second);
+    }
+}
+
+QVector<CollectionList::RefinedTrack> CollectionList::readAccurateProperties(const FileHandleList &files) // static
+{
+    // IdlePriority is the only one that has an effect on Linux, where it
+    // makes the thread SCHED_IDLE.
+    QThread::currentThread()->setPriority(QThread::IdlePriority);
+
+    QVector<RefinedTrack> tracks;
+    tracks.reserve(files.count());
+
+    for(const auto &file : files) {
+        const MediaProbe probe(file.absFilePath(), TagLib::AudioProperties::Accurate);
+        const TagLib::AudioProperties *properties =
+            probe.isValid() ? probe.file()->audioProperties() : nullptr;
+
+        // Keep the estimate if the file can't be read, but don't try again.
+        if(properties)
+            tracks.append({ file, properties->length(), properties->bitrate() });
+        else
+            tracks.append({ file, file.tag()->seconds(), file.tag()->bitrate() });
+    }
+
+    return tracks;
+}
+
+void CollectionList::applyAccurateProperties(const QVector<RefinedTrack> &tracks)
+{
+    // Skip items that were removed or refreshed since the read started.
+
+    for(const auto &track : tracks) {
+        CollectionListItem *item = lookup(track.file.absFilePath());
+        if(!item || item->file() != track.file)
+            continue;
+
+        track.file.tag()->setAudioProperties(track.seconds, track.bitrate);
+        item->refresh();
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // CollectionListItem public methods
 ////////////////////////////////////////////////////////////////////////////////
 
 void CollectionListItem::refresh()
 {
+    CollectionList::instance()->markChanged(file().absFilePath());
+
+    if(file().tag() && file().tag()->propertiesEstimated())
+        CollectionList::instance()->refineAudioProperties(file());
+
+    CollectionList::instance()->m_searchIndex.insert(this);
+
     int offset = CollectionList::instance()->columnOffset();
     int columns = lastColumn() + offset + 1;
 
@@ -482,28 +1021,37 @@ void CollectionListItem::refresh()
     sharedData()->cachedWidths.resize(columns);
 
     for(int i = offset; i < columns; i++) {
-        setText(i, text(i));
         int id = i - offset;
+
+        // Comments are hidden by default, avoid decoding them from the cache
+        // unless they're shown.  See PlaylistItem::data().
+        if(id == CommentColumn) {
+            if(!treeWidget()->isColumnHidden(i))
+                sharedData()->cachedWidths[i] = treeWidget()->fontMetrics().horizontalAdvance(text(i));
+            continue;
+        }
+
+        setText(i, text(i));
         if(id != TrackNumberColumn && id != LengthColumn) {
-            // All columns other than track num and length need local-encoded data for sorting
+            // All columns other than track num and length need case folded
+            // data for sorting and searching
 
-            QString toLower = text(i).toLower();
+            QString folded = SearchKernel::fold(text(i));
 
             // For some columns, we may be able to share some strings
 
             if((id == ArtistColumn) || (id == AlbumColumn) ||
-               (id == GenreColumn)  || (id == YearColumn)  ||
-               (id == CommentColumn))
+               (id == GenreColumn)  || (id == YearColumn))
             {
-                toLower = StringShare::tryShare(toLower);
+                folded = StringShare::tryShare(folded);
 
-                if(id != YearColumn && id != CommentColumn && sharedData()->metadata[id] != toLower) {
+                if(id != YearColumn && sharedData()->metadata[id] != folded) {
                     CollectionList::instance()->removeStringFromDict(sharedData()->metadata[id], id);
                     CollectionList::instance()->addStringToDict(text(i), id);
                 }
             }
 
-            sharedData()->metadata[id] = toLower;
+            sharedData()->metadata[id] = folded;
         }
 
         int newWidth = treeWidget()->fontMetrics().horizontalAdvance(text(i));
@@ -567,6 +1115,7 @@ CollectionListItem::CollectionListItem(CollectionList *parent, const FileHandle
     parent->addToDict(file.absFilePath(), this);
 
     sharedData()->fileHandle = file;
+    parent->assignCacheId(this);
 
     if(file.tag()) {
         refresh();
@@ -586,6 +1135,8 @@ CollectionListItem::~CollectionListItem()
 
     CollectionList *l = CollectionList::instance();
     if(l) {
+        l->releaseCacheId(this);
+        l->m_searchIndex.remove(this);
         l->removeFromDict(file().absFilePath());
         l->removeStringFromDict(file().tag()->album(), AlbumColumn);
         l->removeStringFromDict(file().tag()->artist(), ArtistColumn);
@@ -606,17 +1157,4 @@ void CollectionListItem::removeChildItem(PlaylistItem *child)
         m_children.removeAll(child);
 }
 
-bool CollectionListItem::checkCurrent()
-{
-    if(!file().fileInfo().exists() || !file().fileInfo().isFile())
-        return false;
-
-    if(!file().current()) {
-        file().refresh();
-        refresh();
-    }
-
-    return true;
-}
-
 // vim: set et sw=4 tw=0 sta:
@@ -17,17 +17,18 @@
 #ifndef JUK_COLLECTIONLIST_H
 #define JUK_COLLECTIONLIST_H
 
+#include <QDateTime>
+#include <QFutureWatcher>
 #include <QHash>
 #include <QVector>
 #include <QReadWriteLock>
-
-#include <KFileItem>
+#include <QSet>
 
 #include "playlist.h"
 #include "playlistitem.h"
+#include "searchindex.h"
 
 class ViewMode;
-class KFileItemList;
 class KDirWatch;
 
 /**
@@ -63,6 +64,7 @@ class CollectionListItem : public PlaylistItem
     friend class Playlist;
     friend class CollectionList;
     friend class PlaylistItem;
+    friend class SearchIndex;
 
 public:
     virtual void refresh() override;
@@ -78,22 +80,18 @@ protected:
     void addChildItem(PlaylistItem *child);
     void removeChildItem(PlaylistItem *child);
 
-    /**
-     * Returns true if the item is now up to date (even if this required a refresh) or
-     * false if the item is invalid.
-     */
-    bool checkCurrent();
-
     virtual CollectionListItem *collectionItem() override { return this; }
 
 private:
     bool m_shuttingDown;
     PlaylistItemList m_children;
+    int m_searchSlot = -1; // See SearchIndex
 };
 
 class CollectionList : public Playlist
 {
     friend class CollectionListItem;
+    friend class PlaylistItem;
 
     Q_OBJECT
 
@@ -114,6 +112,31 @@ public:
 
     CollectionListItem *lookup(const QString &file) const;
 
+    /**
+     * Returns the file of the collection track at \a file, or a null
+     * FileHandle if there is none.  Unlike lookup() this is safe to use from
+     * worker threads, as the item cannot be deleted while it is copied.
+     */
+    FileHandle lookupFile(const QString &file) const;
+
+    /**
+     * Returns the item for the track with the persistent ID \a cacheId, see
+     * FileHandle::cacheId().
+     */
+    CollectionListItem *lookupByCacheId(quint32 cacheId) const;
+
+    /**
+     * Returns the number of tracks in the collection directly in \a directory,
+     * which must be a canonical path.  Thread-safe.
+     */
+    int itemCountInDirectory(const QString &directory) const;
+
+    /**
+     * Returns the index used to speed up searching the collection, which is
+     * built the first time it's asked for.
+     */
+    const SearchIndex &searchIndex();
+
     virtual CollectionListItem *createItem(const FileHandle &file,
                                      QTreeWidgetItem * = nullptr) override;
 
@@ -123,19 +146,44 @@ public:
 
     virtual bool canReload() const override { return true; }
 
-    void saveItemsToCache() const;
+    /**
+     * Saves the changes to the collection since the last save to the cache.
+     * Used at shutdown, the changes are also saved periodically.
+     */
+    void saveItemsToCache();
+
+    /**
+     * Starts saving the progress of the scan of \a folders every now and
+     * then, so that a scan which is interrupted picks up where it stopped the
+     * next time around instead of starting over.
+     */
+    void startScanCheckpoints(const QStringList &folders);
+    void stopScanCheckpoints();
 
 public slots:
     virtual void clear() override;
 
+    /**
+     * Checks the cached items against the disk on worker threads.  Changed
+     * tracks are reread and missing tracks removed from the collection as
+     * each batch completes.
+     */
     void slotCheckCache();
 
     void slotRemoveItem(const QString &file);
     void slotRefreshItem(const QString &file);
 
-    void slotNewItems(const KFileItemList &items);
-    void slotRefreshItems(const QList<QPair<KFileItem, KFileItem> > &items);
-    void slotDeleteItems(const KFileItemList &items);
+    /**
+     * Adds, rereads or removes the tracks for files changed on disk, see
+     * LibraryWatcher::filesChanged().
+     */
+    void slotFilesChanged(const QStringList &changed, const QStringList &removed);
+
+    /**
+     * Scans \a directories for new tracks and checks the tracks already in
+     * them, see LibraryWatcher::directoriesChanged().
+     */
+    void slotDirectoriesChanged(const QStringList &directories);
 
 protected:
     CollectionList(PlaylistCollection *collection);
@@ -149,6 +197,25 @@ protected:
     void addToDict(const QString &file, CollectionListItem *item);
     void removeFromDict(const QString &file);
 
+    /**
+     * Gives the track of \a item a persistent ID, keeping the one it was
+     * cached with if that is still free.
+     */
+    void assignCacheId(CollectionListItem *item);
+    void releaseCacheId(CollectionListItem *item);
+
+    /**
+     * Notes that the track at \a file was retagged so that it is included in
+     * the next save to the cache.
+     */
+    void markChanged(const QString &file);
+
+    /**
+     * Queues \a file, whose length and bitrate are estimates, to be read
+     * again accurately in the background.  See Tag::propertiesEstimated().
+     */
+    void refineAudioProperties(const FileHandle &file);
+
     // These methods are also used by CollectionListItem, to manage the
     // strings used in generating the unique sets and tree view mode playlists.
 
@@ -185,8 +252,9 @@ public slots:
     void startLoadingCachedItems();
 
     /**
-     * Loads a few items at a time. Intended to be single-shotted into the event
-     * loop so that loading the music doesn't freeze the GUI.
+     * Inserts a batch of the items decoded so far from the cache. Intended to
+     * be single-shotted into the event loop so that loading the music doesn't
+     * freeze the GUI.
      */
     void loadNextBatchCachedItems();
 
@@ -196,7 +264,49 @@ public slots:
      */
     void completedLoadingCachedItems();
 
+private slots:
+    void slotSaveChanges();
+    void slotCheckpointScan();
+    void slotRefineAudioProperties();
+
 private:
+    struct CheckedTrack
+    {
+        FileHandle file;
+        QString path;
+        QDateTime modified;
+    };
+
+    // What the consistency check found for a batch of tracks.  Changed tracks
+    // are paired with a freshly read handle.
+    struct ConsistencyDiff
+    {
+        QVector<QPair<FileHandle, FileHandle>> changed;
+        FileHandleList missing;
+    };
+
+    /**
+     * Checks the tracks in \a directories, or all of them if it's empty.
+     */
+    void checkConsistency(const QStringList &directories);
+
+    static ConsistencyDiff checkTracks(const QVector<CheckedTrack> &tracks);
+    void applyConsistencyDiff(const ConsistencyDiff &diff);
+
+    // The accurate audio properties of a track with estimated ones.
+    struct RefinedTrack
+    {
+        FileHandle file;
+        int seconds;
+        int bitrate;
+    };
+
+    static QVector<RefinedTrack> readAccurateProperties(const FileHandleList &files);
+    void applyAccurateProperties(const QVector<RefinedTrack> &tracks);
+
+    void scheduleCachedItemInsertion();
+    void saveChanges(bool inBackground);
+
     /**
      * Just the size of the above enum to keep from hard coding it in several
      * locations.
@@ -205,9 +315,43 @@ private:
 
     static CollectionList *m_list;
     QHash<QString, CollectionListItem *> m_itemsDict;
-    mutable QReadWriteLock m_itemsDictLock;
+    SearchIndex m_searchIndex;
+    QHash<QString, int> m_directoryItemCounts; // Guarded by m_itemsDictLock
+    QVector<CollectionListItem *> m_itemsByCacheId;
+    mutable QReadWriteLock m_itemsDictLock; // Also taken to change the items' FileHandles
     KDirWatch *m_dirWatch;
     TagCountDicts m_columnTags;
+
+    // Cache segments are decoded on worker threads and queued up here until
+    // the GUI thread gets around to creating their items.
+    QFutureWatcher<FileHandleList> *m_cacheLoadWatcher = nullptr;
+    FileHandleList m_cachedItemsToInsert;
+    int m_nextCachedItem = 0;
+    bool m_cachedItemInsertionScheduled = false;
+    bool m_insertingCachedItem = false;
+
+    // Items that need a new cache ID, which are only handed out once every
+    // cached track has claimed its own.
+    QVector<CollectionListItem *> m_itemsWithoutCacheId;
+
+    QFutureWatcher<ConsistencyDiff> *m_consistencyCheckWatcher = nullptr;
+    QStringList m_directoriesToCheck;
+
+    // Paths of tracks that were added, retagged or removed since the last
+    // save to the cache.  Guarded by m_itemsDictLock.
+    QSet<QString> m_changedPaths;
+    QTimer *m_saveTimer;
+
+    // Fires while the collection folders are being scanned.
+    QTimer *m_checkpointTimer;
+    QStringList m_scannedFolders;
+
+    // Tracks waiting for their audio properties to be refined, a batch at a
+    // time on a low priority thread once the collection is otherwise idle.
+    QStringList m_tracksToRefine;
+    QSet<QString> m_queuedTracksToRefine;
+    QTimer *m_refineTimer;
+    QFutureWatcher<QVector<RefinedTrack>> *m_refineWatcher = nullptr;
 };
 
 #endif
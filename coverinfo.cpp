@@ -28,7 +28,6 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QImage>
-#include <QScopedPointer>
 #include <QScreen>
 
 // Taglib includes
@@ -43,7 +42,7 @@
 #include <mp4tag.h>
 #include <mp4item.h>
 
-#include "mediafiles.h"
+#include "mediaprobe.h"
 #include "collectionlist.h"
 #include "playlistsearch.h"
 #include "playlistitem.h"
@@ -283,48 +282,16 @@ QString CoverInfo::localPathToCover(const QString &fallbackFileName) const
 
 bool CoverInfo::hasEmbeddedAlbumArt() const
 {
-    QScopedPointer<TagLib::File> fileTag(
-            MediaFiles::fileFactoryByType(m_file.absFilePath()));
+    // Usually known from when the file was scanned, only tags from older
+    // caches need the file opened again.
+    Tag *tag = m_file.tag();
+    if(tag->embeddedArt() != Tag::EmbeddedArtUnknown)
+        return tag->embeddedArt() == Tag::HasEmbeddedArt;
 
-    if (!fileTag->isValid()) {
-        return false;
-    }
-
-    if (TagLib::MPEG::File *mpegFile =
-            dynamic_cast<TagLib::MPEG::File *>(fileTag.data()))
-    {
-        TagLib::ID3v2::Tag *id3tag = mpegFile->ID3v2Tag(false);
+    const bool hasArt = MediaProbe(m_file.absFilePath()).hasEmbeddedArt();
+    tag->setEmbeddedArt(hasArt ? Tag::HasEmbeddedArt : Tag::NoEmbeddedArt);
 
-        if (!id3tag) {
-            qCCritical(JUK_LOG) << m_file.absFilePath() << "seems to have invalid ID3 tag";
-            return false;
-        }
-
-        // Look for attached picture frames.
-        TagLib::ID3v2::FrameList frames = id3tag->frameListMap()["APIC"];
-        return !frames.isEmpty();
-    }
-    else if (TagLib::Ogg::XiphComment *oggTag =
-            dynamic_cast<TagLib::Ogg::XiphComment *>(fileTag->tag()))
-    {
-        return !oggTag->pictureList().isEmpty();
-    }
-    else if (TagLib::FLAC::File *flacFile =
-            dynamic_cast<TagLib::FLAC::File *>(fileTag.data()))
-    {
-        // Look if images are embedded.
-        return !flacFile->pictureList().isEmpty();
-    }
-    else if(TagLib::MP4::File *mp4File =
-            dynamic_cast<TagLib::MP4::File *>(fileTag.data()))
-    {
-        TagLib::MP4::Tag *tag = mp4File->tag();
-        if (tag) {
-            return tag->contains("covr");
-        }
-    }
-
-    return false;
+    return hasArt;
 }
 
 static QImage embeddedMPEGAlbumArt(TagLib::ID3v2::Tag *id3tag)
@@ -448,31 +415,29 @@ void CoverInfo::popup() const
 
 QImage CoverInfo::embeddedAlbumArt() const
 {
-    QScopedPointer<TagLib::File> fileTag(
-            MediaFiles::fileFactoryByType(m_file.absFilePath()));
+    const MediaProbe probe(m_file.absFilePath());
+    if(!probe.isValid())
+        return QImage();
 
-    if (auto *mpegFile =
-            dynamic_cast<TagLib::MPEG::File *>(fileTag.data()))
-    {
-        return embeddedMPEGAlbumArt(mpegFile->ID3v2Tag(false));
-    }
-    else if (auto *oggTag =
-            dynamic_cast<TagLib::Ogg::XiphComment *>(fileTag->tag()))
-    {
-        return embeddedFLACAlbumArt(oggTag->pictureList());
-    }
-    else if (auto *flacFile =
-            dynamic_cast<TagLib::FLAC::File *>(fileTag.data()))
-    {
-        return embeddedFLACAlbumArt(flacFile->pictureList());
-    }
-    else if(auto *mp4File =
-            dynamic_cast<TagLib::MP4::File *>(fileTag.data()))
-    {
-        auto *tag = mp4File->tag();
-        if (tag) {
+    TagLib::File *file = probe.file();
+
+    switch(probe.format()) {
+    case MediaProbe::MPEG:
+        return embeddedMPEGAlbumArt(static_cast<TagLib::MPEG::File *>(file)->ID3v2Tag(false));
+    case MediaProbe::FLAC:
+        return embeddedFLACAlbumArt(static_cast<TagLib::FLAC::File *>(file)->pictureList());
+    case MediaProbe::OggVorbis:
+    case MediaProbe::OggFLAC:
+    case MediaProbe::OggOpus:
+        if(auto *oggTag = dynamic_cast<TagLib::Ogg::XiphComment *>(file->tag()))
+            return embeddedFLACAlbumArt(oggTag->pictureList());
+        break;
+    case MediaProbe::MP4:
+        if(auto *tag = static_cast<TagLib::MP4::File *>(file)->tag())
             return embeddedMP4AlbumArt(tag);
-        }
+        break;
+    default:
+        break;
     }
 
     return QImage();
@@ -35,6 +35,7 @@
 #include "juk.h"
 #include "coverproxy.h"
 #include "juk_debug.h"
+#include "startuptimeline.h"
 
 // This is a dictionary to map the track path to their ID.  Otherwise we'd have
 // to store this info with each CollectionListItem, which would break the cache
@@ -118,7 +119,9 @@ public:
 
     CoverManagerPrivate() : m_timer(new CoverSaveHelper(0)), m_coverProxy(0)
     {
+        StartupTimeline::instance()->begin(StartupTimeline::CoverDatabaseLoad);
         loadCovers();
+        StartupTimeline::instance()->end(StartupTimeline::CoverDatabaseLoad, covers.size());
     }
 
     ~CoverManagerPrivate()
@@ -0,0 +1,122 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "crc32c.h"
+
+#include <QtEndian>
+
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define JUK_CRC32C_SSE42
+#endif
+
+namespace {
+
+const quint32 polynomial = 0x82f63b78; // Reversed Castagnoli polynomial
+
+// Lookup tables for the "slicing-by-8" software implementation, which handles
+// 8 bytes per step.
+
+struct Tables
+{
+    Tables()
+    {
+        for(quint32 i = 0; i < 256; ++i) {
+            quint32 crc = i;
+            for(int bit = 0; bit < 8; ++bit)
+                crc = (crc & 1) ? (crc >> 1) ^ polynomial : crc >> 1;
+            table[0][i] = crc;
+        }
+
+        for(int slice = 1; slice < 8; ++slice) {
+            for(int i = 0; i < 256; ++i) {
+                const quint32 previous = table[slice - 1][i];
+                table[slice][i] = (previous >> 8) ^ table[0][previous & 0xff];
+            }
+        }
+    }
+
+    quint32 table[8][256];
+};
+
+quint32 crc32cSoftware(const uchar *p, size_t size, quint32 crc)
+{
+    static const Tables tables;
+    const auto &t = tables.table;
+
+    while(size >= 8) {
+        const quint32 low = qFromLittleEndian<quint32>(p) ^ crc;
+        const quint32 high = qFromLittleEndian<quint32>(p + 4);
+
+        crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^
+              t[5][(low >> 16) & 0xff] ^ t[4][low >> 24] ^
+              t[3][high & 0xff] ^ t[2][(high >> 8) & 0xff] ^
+              t[1][(high >> 16) & 0xff] ^ t[0][high >> 24];
+
+        p += 8;
+        size -= 8;
+    }
+
+    while(size--)
+        crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+    return crc;
+}
+
+#ifdef JUK_CRC32C_SSE42
+
+__attribute__((target("sse4.2")))
+quint32 crc32cHardware(const uchar *p, size_t size, quint32 crc)
+{
+    quint64 crc64 = crc;
+
+    while(size >= 8) {
+        quint64 value;
+        std::memcpy(&value, p, sizeof(value));
+        crc64 = _mm_crc32_u64(crc64, value);
+
+        p += 8;
+        size -= 8;
+    }
+
+    crc = quint32(crc64);
+
+    while(size--)
+        crc = _mm_crc32_u8(crc, *p++);
+
+    return crc;
+}
+
+#endif
+
+} // namespace
+
+quint32 crc32c(const void *data, size_t size, quint32 crc)
+{
+    const uchar *p = static_cast<const uchar *>(data);
+
+#ifdef JUK_CRC32C_SSE42
+    static const bool haveSse42 = __builtin_cpu_supports("sse4.2");
+    if(haveSse42)
+        return ~crc32cHardware(p, size, ~crc);
+#endif
+
+    return ~crc32cSoftware(p, size, ~crc);
+}
+
+// vim: set et sw=4 tw=0 sta:
@@ -0,0 +1,34 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JUK_CRC32C_H
+#define JUK_CRC32C_H
+
+#include <QtGlobal>
+
+/**
+ * Returns the CRC-32C (Castagnoli) checksum of \a size bytes at \a data.  To
+ * checksum data in several pieces pass the result for the previous piece as
+ * \a crc.
+ *
+ * This uses the SSE 4.2 crc32 instruction where the CPU has it, which makes
+ * it fast enough to check the whole music cache on every startup.
+ */
+quint32 crc32c(const void *data, size_t size, quint32 crc = 0);
+
+#endif
+
+// vim: set et sw=4 tw=0 sta:
@@ -28,6 +28,7 @@
 #include "collectionlist.h"
 #include "coverinfo.h"
 #include "filehandle.h"
+#include "startuptimeline.h"
 #include "juk_debug.h"
 
 DBusCollectionProxy::DBusCollectionProxy (QObject *parent, PlaylistCollection *collection) :
@@ -154,4 +155,9 @@ QString DBusCollectionProxy::trackCover(const QString &track)
     return tempFile.fileName();
 }
 
+QString DBusCollectionProxy::startupProfile()
+{
+    return StartupTimeline::instance()->report();
+}
+
 // vim: set et sw=4 tw=0 sta:
@@ -56,6 +56,12 @@ public slots: // Expose to D-Bus
      */
     QString trackCover(const QString &track);
 
+    /**
+     * Returns how long each phase of starting up took, as a table with one
+     * line per phase.  Phases which have not finished yet are marked as such.
+     */
+    QString startupProfile();
+
 private:
     PlaylistCollection *m_collection;
     QString m_lastCover;
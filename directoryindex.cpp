@@ -0,0 +1,183 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "directoryindex.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+
+#include "cache.h"
+#include "juk_debug.h"
+
+namespace {
+    const quint32 magic = 0x4A754B44; // "JuKD"
+    const qint32 version = 1;
+
+    // Directory modification times may only be precise to the second (or
+    // worse), so a directory changed right before it was listed could change
+    // again without its modification time moving.  Such entries are not
+    // trusted.
+    const qint64 modificationTimeGranularity = 2000;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// public methods
+////////////////////////////////////////////////////////////////////////////////
+
+DirectoryIndex *DirectoryIndex::instance()
+{
+    static DirectoryIndex index;
+    return &index;
+}
+
+DirectoryIndex::Entry DirectoryIndex::entry(const QString &directory) const
+{
+    QMutexLocker locker(&m_lock);
+    return m_entries.value(directory);
+}
+
+void DirectoryIndex::insert(const QString &directory, Entry entry, qint64 listed)
+{
+    if(listed - entry.modified < modificationTimeGranularity)
+        entry.modified = -1;
+
+    QMutexLocker locker(&m_lock);
+    m_entries.insert(directory, entry);
+}
+
+void DirectoryIndex::save(const QStringList &folders)
+{
+    QMutexLocker locker(&m_lock);
+
+    // Walk the index itself rather than the disk to find the directories that
+    // are still part of the collection folders.
+
+    QStringList pending;
+    for(const auto &folder : folders) {
+        const QString canonicalPath = QFileInfo(folder).canonicalFilePath();
+        if(!canonicalPath.isEmpty())
+            pending.append(canonicalPath);
+    }
+
+    QSet<QString> reachable;
+
+    while(!pending.isEmpty()) {
+        const QString directory = pending.takeLast();
+        const auto it = m_entries.constFind(directory);
+
+        if(it == m_entries.cend() || reachable.contains(directory))
+            continue;
+
+        reachable.insert(directory);
+        pending.append(it->subdirectories);
+    }
+
+    for(auto it = m_entries.begin(); it != m_entries.end();) {
+        if(reachable.contains(it.key()))
+            ++it;
+        else
+            it = m_entries.erase(it);
+    }
+
+    Cache::ensureAppDataStorageExists();
+
+    QSaveFile f(fileName());
+
+    if(!f.open(QIODevice::WriteOnly)) {
+        qCCritical(JUK_LOG) << "Error saving directory index:" << f.errorString();
+        return;
+    }
+
+    QDataStream s(&f);
+    s.setVersion(QDataStream::Qt_5_0);
+
+    s << magic << version << quint32(m_entries.count());
+
+    for(auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        s << it.key() << it->modified << it->mediaFileCount
+          << it->subdirectories << it->playlists;
+    }
+
+    if(s.status() != QDataStream::Ok || !f.commit())
+        qCCritical(JUK_LOG) << "Error saving directory index:" << f.errorString();
+}
+
+QString DirectoryIndex::directoryOf(const QString &filePath) // static
+{
+    return filePath.left(filePath.lastIndexOf(QLatin1Char('/')));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// private methods
+////////////////////////////////////////////////////////////////////////////////
+
+DirectoryIndex::DirectoryIndex()
+{
+    load();
+}
+
+void DirectoryIndex::load()
+{
+    QFile f(fileName());
+
+    if(!f.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream s(&f);
+    s.setVersion(QDataStream::Qt_5_0);
+
+    quint32 fileMagic, count;
+    qint32 fileVersion;
+
+    s >> fileMagic >> fileVersion >> count;
+
+    if(fileMagic != magic || fileVersion != version) {
+        qCWarning(JUK_LOG) << "Ignoring directory index with unknown version" << fileVersion;
+        return;
+    }
+
+    m_entries.reserve(count);
+
+    for(quint32 i = 0; i < count && s.status() == QDataStream::Ok; ++i) {
+        QString directory;
+        Entry entry;
+
+        s >> directory >> entry.modified >> entry.mediaFileCount
+          >> entry.subdirectories >> entry.playlists;
+
+        m_entries.insert(directory, entry);
+    }
+
+    // A damaged index would only make the folder scan skip too much, so
+    // start over.
+    if(s.status() != QDataStream::Ok) {
+        qCWarning(JUK_LOG) << "Directory index is damaged, folders will be scanned in full";
+        m_entries.clear();
+    }
+}
+
+QString DirectoryIndex::fileName() // static
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/directories";
+}
+
+// vim: set et sw=4 tw=0 sta:
@@ -0,0 +1,85 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JUK_DIRECTORYINDEX_H
+#define JUK_DIRECTORYINDEX_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+/**
+ * Remembers what the folder scan found in each directory, so that later scans
+ * can skip directories that have not changed.  Adding, removing or renaming
+ * a file updates the modification time of its directory, so a directory with
+ * the same modification time and the same number of tracks in the collection
+ * as last time needs no listing.  Retagged files are found by the consistency
+ * check on the cached items instead.
+ *
+ * Directories are identified by their canonical path.  All methods are
+ * thread-safe as several directory loaders may be running at once.
+ */
+
+class DirectoryIndex
+{
+public:
+    struct Entry
+    {
+        qint64 modified = -1; ///< msecs since the epoch, -1 when unknown
+        quint32 mediaFileCount = 0;
+        QStringList subdirectories;
+        QStringList playlists;
+    };
+
+    static DirectoryIndex *instance();
+
+    /**
+     * Returns the recorded entry for \a directory, or an entry with an unknown
+     * modification time if there is none.
+     */
+    Entry entry(const QString &directory) const;
+
+    /**
+     * Records the contents of \a directory, which was listed at \a listed
+     * (msecs since the epoch).
+     */
+    void insert(const QString &directory, Entry entry, qint64 listed);
+
+    /**
+     * Writes the entries reachable from \a folders to disk and drops the rest.
+     */
+    void save(const QStringList &folders);
+
+    /**
+     * Returns the directory part of \a filePath, in the same form that the
+     * directories are stored in.
+     */
+    static QString directoryOf(const QString &filePath);
+
+private:
+    DirectoryIndex();
+    void load();
+
+    static QString fileName();
+
+    mutable QMutex m_lock;
+    QHash<QString, Entry> m_entries;
+};
+
+#endif
+
+// vim: set et sw=4 tw=0 sta:
@@ -16,12 +16,27 @@
 
 #include "directoryloader.h"
 
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QFileInfo>
-#include <QMutex>
-#include <QMutexLocker>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "mediafiles.h"
 #include "collectionlist.h"
+#include "directoryindex.h"
+#include "juk_debug.h"
 
 // Classifies files into types for potential loading purposes.
 enum class MediaFileType {
@@ -33,101 +48,373 @@ enum class MediaFileType {
 
 static MediaFileType classifyFile(const QFileInfo &fileInfo);
 static FileHandle loadMediaFile(const QString &fileName);
+static void adviseReadahead(const QString &fileName);
+
+// How many loaded files may wait to be inserted.
+static const int LOADED_FILE_QUEUE_SIZE = 2048;
+
+// Files are inserted in batches meant to keep the GUI thread busy for about
+// this long, so that it stays responsive.
+static const qint64 INSERTION_BUDGET_NS = 8 * 1000 * 1000;
+static const int MIN_INSERTION_BATCH_SIZE = 16;
+static const int MAX_INSERTION_BATCH_SIZE = 1024;
+
+// The regions of a file that the tag readers look at first.  ID3v2 and most
+// other tags are at the start, ID3v1, APE tags and sometimes the MP4 index
+// at the end.
+static const qint64 READAHEAD_HEAD_SIZE = 128 * 1024;
+static const qint64 READAHEAD_TAIL_SIZE = 64 * 1024;
+
+// Separate pools, so that listing threads waiting for the tag readers can't
+// keep the tag readers (or anything else on the global pool) from running.
+static QThreadPool *listingPool()
+{
+    static QThreadPool *pool = [] {
+        auto pool = new QThreadPool;
+        pool->setMaxThreadCount(2);
+        return pool;
+    }();
+
+    return pool;
+}
+
+static QThreadPool *tagReaderPool()
+{
+    static QThreadPool *pool = new QThreadPool;
+    return pool;
+}
 
-DirectoryLoader::DirectoryLoader(const QString &dir, QObject *parent)
+DirectoryLoader::DirectoryLoader(const QString &dir, DirectoryIndex *index, QObject *parent)
     : QObject(parent)
-    , m_dirIterator(
-        dir,
-        QDir::AllEntries | QDir::NoDotAndDotDot,
-        QDirIterator::Subdirectories | QDirIterator::FollowSymlinks)
+    , m_dir(dir)
+    , m_index(index)
+    , m_mediaFiles(MEDIA_FILE_QUEUE_SIZE)
+    , m_loadedFiles(LOADED_FILE_QUEUE_SIZE)
+    , m_insertionScheduled(false)
+    , m_insertionBatchSize(64)
+{
+    connect(qApp, &QCoreApplication::aboutToQuit, this, &DirectoryLoader::cancel);
+}
+
+DirectoryLoader::~DirectoryLoader()
 {
+    cancel();
+    m_listing.waitForFinished();
 }
 
-void DirectoryLoader::startLoading()
+void DirectoryLoader::setReadaheadDepth(int depth)
 {
-    static const int BATCH_SIZE = 256;
-    FileHandleList files;
+    m_readaheadDepth = qBound(0, depth, MEDIA_FILE_QUEUE_SIZE);
+}
+
+void DirectoryLoader::setFolderScope(const PathTrie &scope)
+{
+    m_scope = scope;
+}
+
+QFuture<void> DirectoryLoader::start()
+{
+    m_stopwatch.start();
+    m_done.reportStarted();
+    m_listing = QtConcurrent::run(listingPool(), [this]() { listFiles(); });
+
+    return m_done.future();
+}
+
+void DirectoryLoader::cancel()
+{
+    m_mediaFiles.abort();
+    m_loadedFiles.abort();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// private methods
+////////////////////////////////////////////////////////////////////////////////
+
+void DirectoryLoader::listFiles()
+{
+    QVector<QFuture<void>> tagReaders;
+    const int readerCount = qMax(1, QThread::idealThreadCount());
+
+    for(int i = 0; i < readerCount; ++i)
+        tagReaders << QtConcurrent::run(tagReaderPool(), [this]() { readTags(); });
+
+    if(m_index)
+        loadIndexed();
+    else
+        loadListed();
+
+    m_mediaFiles.close();
+
+    for(auto &reader : tagReaders)
+        reader.waitForFinished();
+
+    m_loadedFiles.close();
+    scheduleInsertion();
+}
+
+void DirectoryLoader::loadListed()
+{
+    QStringList pending(QFileInfo(m_dir).canonicalFilePath());
+    QSet<QString> visited; // Symlinks can make loops
+
+    while(!pending.isEmpty()) {
+        const QString dir = pending.takeLast();
+
+        // Excluded directories are skipped before they're listed.
+        if(dir.isEmpty() || visited.contains(dir) || m_scope.isExcluded(dir))
+            continue;
+
+        visited.insert(dir);
+
+        const QFileInfoList entries = QDir(dir).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot);
+
+        for(const auto &fileInfo : entries) {
+            switch(classifyFile(fileInfo)) {
+                case MediaFileType::Playlist:
+                    emit loadedPlaylist(fileInfo.filePath());
+                    break;
+
+                case MediaFileType::MediaFile:
+                    if(!addMediaFile(fileInfo.canonicalFilePath()))
+                        return;
+                    break;
+
+                case MediaFileType::Directory:
+                    pending.append(fileInfo.canonicalFilePath());
+                    break;
+
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+void DirectoryLoader::loadIndexed()
+{
+    const CollectionList *collection = CollectionList::instance();
+
+    QStringList pending(QFileInfo(m_dir).canonicalFilePath());
+    QSet<QString> visited; // Symlinks can make loops
+    int skipped = 0, listed = 0;
+
+    while(!pending.isEmpty()) {
+        const QString dir = pending.takeLast();
+
+        if(dir.isEmpty() || visited.contains(dir) || m_scope.isExcluded(dir))
+            continue;
+
+        visited.insert(dir);
 
-    while(m_dirIterator.hasNext()) {
-        const auto fileName = m_dirIterator.next();
-        const QFileInfo fileInfo(fileName);
-        const auto type = classifyFile(fileInfo);
+        const QFileInfo dirInfo(dir);
+        if(!dirInfo.isDir())
+            continue;
 
-        switch(type) {
-            case MediaFileType::Playlist:
-                emit loadedPlaylist(fileName);
-                break;
+        const qint64 modified = dirInfo.lastModified().toMSecsSinceEpoch();
+        DirectoryIndex::Entry entry = m_index->entry(dir);
 
-            case MediaFileType::MediaFile:
+        if(entry.modified >= 0 && entry.modified == modified &&
+           int(entry.mediaFileCount) == collection->itemCountInDirectory(dir))
+        {
+            for(const auto &playlist : qAsConst(entry.playlists))
+                emit loadedPlaylist(playlist);
+
+            pending.append(entry.subdirectories);
+            ++skipped;
+            continue;
+        }
+
+        const qint64 listedAt = QDateTime::currentMSecsSinceEpoch();
+        const QFileInfoList entries = QDir(dir).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot);
+
+        entry = DirectoryIndex::Entry();
+        entry.modified = modified;
+
+        for(const auto &fileInfo : entries) {
+            switch(classifyFile(fileInfo)) {
+                case MediaFileType::MediaFile:
                 {
-                    const auto loadedMetadata = loadMediaFile(fileInfo.canonicalFilePath());
-                    files << loadedMetadata;
+                    const QString fileName = fileInfo.canonicalFilePath();
+                    if(!addMediaFile(fileName))
+                        return;
 
-                    if(files.count() >= BATCH_SIZE) {
-                        emit loadedFiles(files);
-                        files.clear();
-                    }
+                    // Symlinked tracks live in another directory.
+                    if(DirectoryIndex::directoryOf(fileName) == dir)
+                        ++entry.mediaFileCount;
+                    break;
                 }
-                break;
-
-            case MediaFileType::Directory:
-                // this should be impossible based on the
-                // QDirIterator settings
-                continue;
-            case MediaFileType::UnusableFile:
-                continue;
-            default:
-                continue;
+
+                case MediaFileType::Playlist:
+                    entry.playlists.append(fileInfo.filePath());
+                    emit loadedPlaylist(fileInfo.filePath());
+                    break;
+
+                case MediaFileType::Directory:
+                    entry.subdirectories.append(fileInfo.canonicalFilePath());
+                    pending.append(entry.subdirectories.last());
+                    break;
+
+                default:
+                    break;
+            }
         }
+
+        m_index->insert(dir, entry, listedAt);
+        ++listed;
     }
 
-    if(!files.isEmpty()) {
-        emit loadedFiles(files);
+    const auto stats = MediaFiles::classifierStats();
+    qCDebug(JUK_LOG) << "Scanned" << m_dir << "listing" << listed << "and skipping"
+                     << skipped << "unchanged directories";
+    qCDebug(JUK_LOG) << "Files classified so far:" << stats.byExtension
+                     << "by extension," << stats.sniffed << "by contents";
+}
+
+bool DirectoryLoader::addMediaFile(const QString &fileName)
+{
+    // The first files waiting for the tag readers are the next ones they'll
+    // get to, so have the disk start on those.  Files already in the
+    // collection aren't read at all.
+    if(m_mediaFiles.count() < m_readaheadDepth &&
+       !CollectionList::instance()->hasItem(fileName))
+    {
+        adviseReadahead(fileName);
     }
+
+    return m_mediaFiles.push(fileName);
 }
 
-MediaFileType classifyFile(const QFileInfo &fileInfo)
+void DirectoryLoader::readTags()
 {
-    const QString path = fileInfo.canonicalFilePath();
+    QString fileName;
 
-    if(fileInfo.isFile() && fileInfo.isReadable() &&
-        MediaFiles::isMediaFile(path))
-    {
-        return MediaFileType::MediaFile;
+    while(m_mediaFiles.pop(fileName)) {
+        if(!m_loadedFiles.push(loadMediaFile(fileName)))
+            return;
+
+        scheduleInsertion();
     }
+}
 
-    // These are all the files we care about, anything remaining needs to be a
-    // directory or playlist or it must be unusable
+void DirectoryLoader::scheduleInsertion()
+{
+    if(!m_insertionScheduled.exchange(true))
+        QMetaObject::invokeMethod(this, &DirectoryLoader::insertLoadedFiles, Qt::QueuedConnection);
+}
+
+void DirectoryLoader::insertLoadedFiles()
+{
+    m_insertionScheduled = false;
+
+    const FileHandleList files = m_loadedFiles.tryPop(m_insertionBatchSize);
+
+    if(!files.isEmpty()) {
+        QElapsedTimer stopwatch;
+        stopwatch.start();
 
-    if(MediaFiles::isPlaylistFile(path)) {
-        return MediaFileType::Playlist;
+        emit loadedFiles(files);
+        m_filesLoaded += files.count();
+
+        // Aim for batches that take about the insertion budget, so that a
+        // slow GUI gets small batches and a fast one doesn't keep the tag
+        // readers waiting on a full queue.
+        const qint64 elapsed = stopwatch.nsecsElapsed();
+
+        if(elapsed > INSERTION_BUDGET_NS) {
+            m_insertionBatchSize = qMax(MIN_INSERTION_BATCH_SIZE, m_insertionBatchSize / 2);
+        }
+        else if(elapsed < INSERTION_BUDGET_NS / 2 && files.count() == m_insertionBatchSize) {
+            m_insertionBatchSize = qMin(MAX_INSERTION_BATCH_SIZE, m_insertionBatchSize * 2);
+        }
     }
 
+    if(m_loadedFiles.isFinished()) {
+        if(m_done.isFinished())
+            return;
+
+        const qint64 elapsed = qMax<qint64>(m_stopwatch.elapsed(), 1);
+        qCDebug(JUK_LOG) << "Loaded" << m_filesLoaded << "files from" << m_dir
+                         << "in" << elapsed << "ms," << (m_filesLoaded * 1000 / elapsed)
+                         << "files/s with a readahead depth of" << m_readaheadDepth;
+
+        m_done.reportFinished();
+        return;
+    }
+
+    if(m_loadedFiles.count() > 0)
+        scheduleInsertion();
+}
+
+MediaFileType classifyFile(const QFileInfo &fileInfo)
+{
     if(fileInfo.isDir()) {
         return MediaFileType::Directory;
     }
 
+    // Symlinks are classified by what they point to, other paths don't need
+    // to be resolved for that.
+    const QString path = fileInfo.isSymLink()
+        ? fileInfo.canonicalFilePath()
+        : fileInfo.filePath();
+
+    switch(MediaFiles::classify(path)) {
+        case MediaFiles::FileKind::Media:
+            if(fileInfo.isFile() && fileInfo.isReadable())
+                return MediaFileType::MediaFile;
+            break;
+
+        case MediaFiles::FileKind::Playlist:
+            return MediaFileType::Playlist;
+
+        default:
+            break;
+    }
+
     return MediaFileType::UnusableFile;
 }
 
 FileHandle loadMediaFile(const QString &fileName)
 {
-    // Just because our GUI thread accesses are serialized by signal/slot magic
-    // doesn't mean that our non-GUI threads don't require deconfliction
-    // Neither FileHandle nor TagLib are not thread-safe so synchronize access
-    // to this function.
-    static QMutex fhLock;
-    QMutexLocker locker(&fhLock);
+    // Called concurrently from the tag reading threads.  Each call reads its
+    // tags through a TagLib::File of its own (see Tag::Tag()) and the
+    // FileHandle is not shared with anything else until it is emitted, so no
+    // locking is needed beyond the collection's own read lock.
 
-    const auto item = CollectionList::instance()->lookup(fileName);
-    if(item) {
+    const FileHandle loaded = CollectionList::instance()->lookupFile(fileName);
+    if(!loaded.isNull()) {
         // Don't re-load a file if it's already loaded once
-        return FileHandle(item->file());
+        return loaded;
     }
-    else {
-        FileHandle loadedMetadata(fileName);
-        (void) loadedMetadata.tag(); // Ensure tag is read
 
-        return loadedMetadata;
+    FileHandle loadedMetadata(fileName);
+    (void) loadedMetadata.tag(); // Ensure tag is read
+
+    return loadedMetadata;
+}
+
+void adviseReadahead(const QString &fileName)
+{
+#if defined(Q_OS_UNIX) && defined(POSIX_FADV_WILLNEED)
+    const int fd = ::open(QFile::encodeName(fileName).constData(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return;
+
+    // The kernel starts reading in the background and keeps the pages
+    // cached after the descriptor is closed.
+    struct stat info;
+    if(::fstat(fd, &info) == 0) {
+        const qint64 size = info.st_size;
+        ::posix_fadvise(fd, 0, READAHEAD_HEAD_SIZE, POSIX_FADV_WILLNEED);
+
+        if(size > READAHEAD_HEAD_SIZE) {
+            const qint64 tail = qMax(READAHEAD_HEAD_SIZE, size - READAHEAD_TAIL_SIZE);
+            ::posix_fadvise(fd, tail, size - tail, POSIX_FADV_WILLNEED);
+        }
     }
+
+    ::close(fd);
+#else
+    Q_UNUSED(fileName);
+#endif
 }
@@ -18,30 +18,100 @@
 #define JUK_DIRECTORYLOADER_H
 
 #include <QObject>
-#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QFutureInterface>
 
+#include <atomic>
+
+#include "boundedqueue.h"
 #include "filehandle.h"
+#include "pathtrie.h"
+
+class DirectoryIndex;
 
 /**
- * Loads music files and their metadata from a given directory, emitting loaded
- * files in a batch periodically. Intended for use in a separate thread as a
- * worker object.
+ * Loads music files and their metadata from a given directory as a pipeline
+ * of stages connected by BoundedQueues:
+ *
+ *  1. Listing and classifying the files, on a thread of its own.  (These are
+ *     one stage as the listing needs to know which entries are directories.)
+ *  2. Reading the tags of the media files, on several threads.
+ *  3. Handing the loaded files to loadedFiles() on the GUI thread, in
+ *     batches sized to take only a few milliseconds to insert.
+ *
+ * A stage that falls behind makes the ones before it wait rather than queue
+ * up everything, so the memory used doesn't depend on the size of the
+ * directory.
+ *
+ * If a DirectoryIndex is given, subdirectories which have not changed since
+ * they were last indexed and whose tracks are all in the collection are not
+ * listed again, and the index is updated for the ones which are.
  */
 class DirectoryLoader : public QObject {
     Q_OBJECT
 
 public:
-    DirectoryLoader(const QString &dir, QObject *parent = nullptr);
+    static constexpr int MEDIA_FILE_QUEUE_SIZE = 256; ///< Listed files waiting for the tag readers.
+
+    DirectoryLoader(const QString &dir, DirectoryIndex *index = nullptr, QObject *parent = nullptr);
+    virtual ~DirectoryLoader();
+
+    /**
+     * Sets how many of the files listed ahead of the tag readers the kernel
+     * is asked to start reading in advance, on systems which support it.
+     * 0 disables the hints.  Must be called before start().
+     */
+    void setReadaheadDepth(int depth);
+
+    /**
+     * Skips the directories that \a scope excludes, without listing them.
+     * Must be called before start().
+     */
+    void setFolderScope(const PathTrie &scope);
+
+    /**
+     * Starts loading.  The returned future finishes once the last files have
+     * been passed to loadedFiles().
+     */
+    QFuture<void> start();
 
 public slots:
-    void startLoading();
+    /**
+     * Stops loading as soon as possible, dropping files not yet passed to
+     * loadedFiles().
+     */
+    void cancel();
 
 signals:
     void loadedFiles(FileHandleList files);
     void loadedPlaylist(QString fileName);
 
 private:
-    QDirIterator m_dirIterator;
+    void listFiles();
+    void loadListed();
+    void loadIndexed();
+    void readTags();
+
+    bool addMediaFile(const QString &fileName);
+
+    void scheduleInsertion();
+    void insertLoadedFiles();
+
+    QString m_dir;
+    DirectoryIndex *m_index;
+    int m_readaheadDepth = 0;
+    PathTrie m_scope;
+
+    BoundedQueue<QString> m_mediaFiles;
+    BoundedQueue<FileHandle> m_loadedFiles;
+
+    QFuture<void> m_listing;
+    QFutureInterface<void> m_done;
+    std::atomic<bool> m_insertionScheduled;
+    int m_insertionBatchSize;
+    qint64 m_filesLoaded = 0;
+    QElapsedTimer m_stopwatch;
 };
 
 #endif // JUK_DIRECTORYLOADER_H
@@ -52,12 +52,22 @@ public:
         baseModificationTime = fileInfo.lastModified();
     }
 
+    FileHandlePrivate(const QString &canonicalPath, Tag *cachedTag, const QDateTime &modificationTime)
+        : tag(cachedTag)
+        , coverInfo(nullptr)
+        , fileInfo(canonicalPath)
+        , absFilePath(canonicalPath)
+        , baseModificationTime(modificationTime)
+    {
+    }
+
     mutable QScopedPointer<Tag> tag;
     mutable QScopedPointer<CoverInfo> coverInfo;
     QFileInfo fileInfo;
     QString absFilePath;
     QDateTime baseModificationTime;
     mutable QDateTime lastModified;
+    quint32 cacheId = 0;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -91,6 +101,11 @@ FileHandle::FileHandle(const QString &path, CacheDataStream &s)
         read(s);
 }
 
+FileHandle::FileHandle(const QString &path, Tag *tag, const QDateTime &modificationTime)
+    : d(new FileHandlePrivate(path, tag, modificationTime))
+{
+}
+
 FileHandle::~FileHandle() = default;
 
 void FileHandle::refresh()
@@ -111,7 +126,11 @@ void FileHandle::setFile(const QString &path)
         return;
     }
 
+    // Still the same track as far as the collection is concerned.
+    const quint32 cacheId = d->cacheId;
+
     d = new FileHandlePrivate(QFileInfo(path));
+    d->cacheId = cacheId;
 }
 
 Tag *FileHandle::tag() const
@@ -161,6 +180,21 @@ const QDateTime &FileHandle::lastModified() const
     return d->lastModified;
 }
 
+const QDateTime &FileHandle::baseModificationTime() const
+{
+    return d->baseModificationTime;
+}
+
+quint32 FileHandle::cacheId() const
+{
+    return d->cacheId;
+}
+
+void FileHandle::setCacheId(quint32 id)
+{
+    d->cacheId = id;
+}
+
 void FileHandle::read(CacheDataStream &s)
 {
     switch(s.cacheVersion()) {
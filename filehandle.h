@@ -45,6 +45,13 @@ public:
     explicit FileHandle(const QString &path);
     FileHandle(const QString &path, CacheDataStream &s);
 
+    /**
+     * Restores a file handle from the collection cache.  \a path must already
+     * be canonical as it is trusted without touching the disk, and the
+     * FileHandle takes ownership of \a tag.
+     */
+    FileHandle(const QString &path, Tag *tag, const QDateTime &modificationTime);
+
     // manually declared so its definition can be delayed until .cpp
     ~FileHandle();
 
@@ -63,6 +70,19 @@ public:
     bool current() const;
     const QDateTime &lastModified() const;
 
+    /**
+     * Returns the modification time of the file when its tag was read.
+     */
+    const QDateTime &baseModificationTime() const;
+
+    /**
+     * The persistent ID of the track in the collection cache, which the
+     * playlists cache refers to tracks by.  Assigned by the CollectionList,
+     * 0 until then.
+     */
+    quint32 cacheId() const;
+    void setCacheId(quint32 id);
+
     void read(CacheDataStream &s);
 
     FileHandle &operator=(const FileHandle &f);
@@ -20,6 +20,9 @@
 
 #include <KLocalizedString>
 
+#include <algorithm>
+
+#include "cache.h"
 #include "collectionlist.h"
 #include "playermanager.h"
 #include "juk-exception.h"
@@ -105,24 +108,53 @@ QDataStream &operator<<(QDataStream &s, const HistoryPlaylist &p)
 {
     PlaylistItemList l = const_cast<HistoryPlaylist *>(&p)->items();
 
-    s << qint32(l.count());
+    // Tracks without a cache ID aren't written, so leave out their times too.
+    l.erase(std::remove_if(l.begin(), l.end(),
+                [](const PlaylistItem *item) { return item->file().cacheId() == 0; }),
+            l.end());
 
-    for(PlaylistItemList::ConstIterator it = l.constBegin(); it != l.constEnd(); ++it) {
-        const HistoryPlaylistItem *i = static_cast<HistoryPlaylistItem *>(*it);
-        s << i->file().absFilePath();
-        s << i->dateTime();
-    }
+    QVector<QDateTime> dateTimes;
+    dateTimes.reserve(l.count());
+
+    for(const auto &item : qAsConst(l))
+        dateTimes << static_cast<const HistoryPlaylistItem *>(item)->dateTime();
+
+    Cache::instance()->writePlaylistTracks(s, l);
+    s << dateTimes;
 
     return s;
 }
 
 QDataStream &operator>>(QDataStream &s, HistoryPlaylist &p)
 {
+    HistoryPlaylistItem *after = 0;
+
+    if(Cache::instance()->loadingPlaylistsVersion() >= 4) {
+        const FileHandleList files = Cache::instance()->readPlaylistTracks(s);
+        QVector<QDateTime> dateTimes;
+        s >> dateTimes;
+
+        if(dateTimes.count() < files.count())
+            throw BICStreamException();
+
+        for(int i = 0; i < files.count(); ++i) {
+            if(files[i].isNull())
+                continue;
+
+            HistoryPlaylistItem *a = p.createItem(files[i], after);
+            if(Q_LIKELY(a)) {
+                after = a;
+                after->setDateTime(dateTimes[i]);
+            }
+        }
+
+        p.playlistItemsChanged();
+        return s;
+    }
+
     qint32 count;
     s >> count;
 
-    HistoryPlaylistItem *after = 0;
-
     QString fileName;
     QDateTime dateTime;
 
@@ -55,6 +55,7 @@
 #include "scrobbleconfigdlg.h"
 #include "scrobbler.h"
 #include "slideraction.h"
+#include "startuptimeline.h"
 #include "statuslabel.h"
 #include "systemtray.h"
 #include "tagguesserconfigdlg.h"
@@ -162,6 +163,8 @@ JuK::JuK(const QStringList &filesToOpen, QWidget *parent)
     connect(qApp, &QGuiApplication::commitDataRequest, this, [this]() { saveConfig(); },
             Qt::DirectConnection);
 
+    StartupTimeline::instance()->watchFirstPaint(this);
+
     // slotCheckCache loads the cached entries first to populate the collection list
 
     QTimer::singleShot(0, this, SLOT(slotClearOldCovers()));
@@ -25,7 +25,7 @@
 #include <id3v2framefactory.h>
 
 #include "cache.h"
-#include "mediafiles.h"
+#include "mediaprobe.h"
 #include "stringshare.h"
 #include "juk_debug.h"
 
@@ -47,10 +47,11 @@ Tag::Tag(const QString &fileName) :
         return;
     }
 
-    TagLib::File *file = MediaFiles::fileFactoryByType(fileName);
-    if(file && file->isValid()) {
-        setup(file);
-        delete file;
+    // Only a quick look at the audio properties here so that new tracks show
+    // up fast, see propertiesEstimated().
+    const MediaProbe probe(fileName, TagLib::AudioProperties::Fast);
+    if(probe.isValid()) {
+        setup(probe);
     }
     else {
         qCCritical(JUK_LOG) << "Couldn't resolve the mime type of \"" <<
@@ -62,14 +63,15 @@ bool Tag::save() const
 {
     bool result;
     TagLib::ID3v2::FrameFactory::instance()->setDefaultTextEncoding(TagLib::String::UTF8);
-    TagLib::File *file = MediaFiles::fileFactoryByType(m_fileName);
+    const MediaProbe probe(m_fileName);
+    TagLib::File *file = probe.file();
 
     if(file && !file->readOnly() && file->isValid() && file->tag()) {
         file->tag()->setTitle(TagLib::String(m_title.toUtf8().constData(), TagLib::String::UTF8));
         file->tag()->setArtist(TagLib::String(m_artist.toUtf8().constData(), TagLib::String::UTF8));
         file->tag()->setAlbum(TagLib::String(m_album.toUtf8().constData(), TagLib::String::UTF8));
         file->tag()->setGenre(TagLib::String(m_genre.toUtf8().constData(), TagLib::String::UTF8));
-        file->tag()->setComment(TagLib::String(m_comment.toUtf8().constData(), TagLib::String::UTF8));
+        file->tag()->setComment(TagLib::String(comment().toUtf8().constData(), TagLib::String::UTF8));
         file->tag()->setTrack(m_track);
         file->tag()->setYear(m_year);
         result = file->save();
@@ -79,10 +81,35 @@ bool Tag::save() const
         result = false;
     }
 
-    delete file;
     return result;
 }
 
+QString Tag::comment() const
+{
+    if(m_mappedComment) {
+        m_comment = CacheMapping::string(m_mappedComment);
+        m_mappedComment = nullptr;
+        m_commentMapping.reset();
+    }
+
+    return m_comment;
+}
+
+void Tag::setComment(const QString &value)
+{
+    m_comment = value;
+    m_mappedComment = nullptr;
+    m_commentMapping.reset();
+}
+
+QString Tag::lengthString() const
+{
+    const int secs = m_seconds % 60;
+    const int minutes = (m_seconds - secs) / 60;
+
+    return QString::number(minutes) + (secs >= 10 ? ":" : ":0") + QString::number(secs);
+}
+
 QString Tag::playingString() const
 {
     QString str;
@@ -104,6 +131,7 @@ CacheDataStream &Tag::read(CacheDataStream &s)
         qint32 year;
         qint32 bitrate;
         qint32 seconds;
+        QString lengthString; // Computed from seconds
 
         s >> m_title
           >> m_artist
@@ -113,7 +141,7 @@ CacheDataStream &Tag::read(CacheDataStream &s)
           >> year
           >> m_comment
           >> bitrate
-          >> m_lengthString
+          >> lengthString
           >> seconds;
 
         m_track = track;
@@ -123,8 +151,8 @@ CacheDataStream &Tag::read(CacheDataStream &s)
         break;
     }
     default: {
-        static QString dummyString;
-        static int dummyInt;
+        QString dummyString;
+        int dummyInt;
         QString bitrateString;
 
         s >> dummyInt
@@ -139,7 +167,7 @@ CacheDataStream &Tag::read(CacheDataStream &s)
           >> dummyString
           >> m_comment
           >> bitrateString
-          >> m_lengthString
+          >> dummyString
           >> m_seconds
           >> dummyString;
 
@@ -170,8 +198,10 @@ Tag::Tag(const QString &fileName, bool) :
 
 }
 
-void Tag::setup(TagLib::File *file)
+void Tag::setup(const MediaProbe &probe)
 {
+    TagLib::File *file = probe.file();
+
     if(!file || !file->tag()) {
         qCWarning(JUK_LOG) << "Can't setup invalid file" << m_fileName;
         return;
@@ -186,13 +216,13 @@ void Tag::setup(TagLib::File *file)
     m_track = file->tag()->track();
     m_year  = file->tag()->year();
 
-    m_seconds = file->audioProperties()->length();
-    m_bitrate = file->audioProperties()->bitrate();
-
-    const int seconds = m_seconds % 60;
-    const int minutes = (m_seconds - seconds) / 60;
+    if(file->audioProperties()) {
+        setAudioProperties(file->audioProperties()->length(),
+                           file->audioProperties()->bitrate());
+        m_propertiesEstimated = probe.hasEstimatedProperties();
+    }
 
-    m_lengthString = QString::number(minutes) + (seconds >= 10 ? ":" : ":0") + QString::number(seconds);
+    m_embeddedArt = probe.hasEmbeddedArt() ? HasEmbeddedArt : NoEmbeddedArt;
 
     if(m_title.isEmpty()) {
         int i = m_fileName.lastIndexOf('/');
@@ -204,12 +234,18 @@ void Tag::setup(TagLib::File *file)
     m_isValid = true;
 }
 
+void Tag::setAudioProperties(int seconds, int bitrate)
+{
+    m_seconds = seconds;
+    m_bitrate = bitrate;
+    m_propertiesEstimated = false;
+}
+
 void Tag::minimizeMemoryUsage()
 {
     // Try to reduce memory usage: share tags that frequently repeat, squeeze others
 
     m_title.squeeze();
-    m_lengthString.squeeze();
 
     m_comment = StringShare::tryShare(m_comment);
     m_artist  = StringShare::tryShare(m_artist);
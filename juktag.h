@@ -20,9 +20,11 @@
 
 #include <QDateTime>
 
-namespace TagLib { class File; }
+#include <memory>
 
 class CacheDataStream;
+class CacheMapping;
+class MediaProbe;
 
 /*!
  * This should really be called "metadata" and may at some point be titled as
@@ -32,7 +34,14 @@ class CacheDataStream;
 class Tag
 {
     friend class FileHandle;
+    friend class Cache;
 public:
+    /**
+     * Whether album art is embedded in the file.  Known for tags read from
+     * the file and for most tags restored from the cache.
+     */
+    enum EmbeddedArt { EmbeddedArtUnknown, NoEmbeddedArt, HasEmbeddedArt };
+
     Tag(const QString &fileName);
     /**
      * Create an empty tag.  Used in FileHandle for cache restoration.
@@ -47,7 +56,7 @@ public:
     QString genre() const { return m_genre; }
     int track() const { return m_track; }
     int year() const { return m_year; }
-    QString comment() const { return m_comment; }
+    QString comment() const;
 
     QString fileName() const { return m_fileName; }
 
@@ -57,20 +66,36 @@ public:
     void setGenre(const QString &value) { m_genre = value; }
     void setTrack(int value) { m_track = value; }
     void setYear(int value) { m_year = value; }
-    void setComment(const QString &value) { m_comment = value; }
+    void setComment(const QString &value);
 
     void setFileName(const QString &value) { m_fileName = value; }
 
     int seconds() const { return m_seconds; }
     int bitrate() const { return m_bitrate; }
 
+    /**
+     * Sets the length and bitrate, which are then no longer estimated.
+     */
+    void setAudioProperties(int seconds, int bitrate);
+
+    /**
+     * Whether seconds() and bitrate() are only estimates from the quick read
+     * of the file done when the tag was created.  The collection reads the
+     * accurate values for these tracks later on in the background.
+     */
+    bool propertiesEstimated() const { return m_propertiesEstimated; }
+    void setPropertiesEstimated(bool estimated) { m_propertiesEstimated = estimated; }
+
     bool isValid() const { return m_isValid; }
 
+    EmbeddedArt embeddedArt() const { return m_embeddedArt; }
+    void setEmbeddedArt(EmbeddedArt value) { m_embeddedArt = value; }
+
     /**
      * As a convenience, since producing a length string from a number of second
      * isn't a one liner, provide the length in string form.
      */
-    QString lengthString() const { return m_lengthString; }
+    QString lengthString() const;
 
     /**
      * Convenience function to return a concise string describing the track,
@@ -81,7 +106,7 @@ public:
     CacheDataStream &read(CacheDataStream &s);
 
 private:
-    void setup(TagLib::File *file);
+    void setup(const MediaProbe &probe);
     void minimizeMemoryUsage();
 
     QString m_fileName;
@@ -89,14 +114,21 @@ private:
     QString m_artist;
     QString m_album;
     QString m_genre;
-    QString m_comment;
+    mutable QString m_comment;
     int m_track;
     int m_year;
     int m_seconds;
     int m_bitrate;
     QDateTime m_modificationTime;
-    QString m_lengthString;
     bool m_isValid;
+    EmbeddedArt m_embeddedArt = EmbeddedArtUnknown;
+    bool m_propertiesEstimated = false;
+
+    // Comments are rarely looked at, so for tags restored from the collection
+    // cache the comment is only decoded from the mapped cache file when it's
+    // first asked for.
+    mutable std::shared_ptr<const CacheMapping> m_commentMapping;
+    mutable const uchar *m_mappedComment = nullptr;
 };
 
 QDataStream &operator<<(QDataStream &s, const Tag &t);
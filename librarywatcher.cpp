@@ -0,0 +1,394 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "librarywatcher.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QSocketNotifier>
+#include <QtConcurrent>
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "mediafiles.h"
+#include "juk_debug.h"
+
+// Changes are reported once nothing has happened for this long, but never
+// later than the maximum delay after the first of them.
+static const int QUIET_PERIOD_MS = 750;
+static const int MAXIMUM_DELAY_MS = 5000;
+
+#ifdef Q_OS_LINUX
+static const quint32 INOTIFY_MASK =
+    IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+    IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_EXCL_UNLINK;
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// public methods
+////////////////////////////////////////////////////////////////////////////////
+
+LibraryWatcher::LibraryWatcher(QObject *parent) : QObject(parent)
+{
+    m_reportTimer.setSingleShot(true);
+    connect(&m_reportTimer, &QTimer::timeout, this, &LibraryWatcher::report);
+}
+
+LibraryWatcher::~LibraryWatcher()
+{
+    stopWatching();
+}
+
+void LibraryWatcher::setFolders(const QStringList &folders, const PathTrie &scope)
+{
+    m_folders.clear();
+    for(const auto &folder : folders) {
+        const QString canonicalFolder = QDir(folder).canonicalPath();
+        if(!canonicalFolder.isEmpty())
+            m_folders << canonicalFolder;
+    }
+
+    m_scope = scope;
+
+    if(m_enabled) {
+        stopWatching();
+        startWatching();
+    }
+}
+
+void LibraryWatcher::setEnabled(bool enable)
+{
+    if(enable == m_enabled)
+        return;
+
+    m_enabled = enable;
+
+    if(enable)
+        startWatching();
+    else
+        stopWatching();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// private methods
+////////////////////////////////////////////////////////////////////////////////
+
+void LibraryWatcher::startWatching()
+{
+#ifdef Q_OS_LINUX
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if(m_inotifyFd >= 0) {
+        m_notifier = new QSocketNotifier(m_inotifyFd, QSocketNotifier::Read, this);
+        // activated() is overloaded since Qt 5.15
+        connect(m_notifier, SIGNAL(activated(int)), this, SLOT(readEvents()));
+    }
+    else {
+        qCWarning(JUK_LOG) << "Unable to use inotify, only watching for changed directories";
+    }
+#endif
+
+    if(m_inotifyFd < 0) {
+        m_fallbackWatcher = new QFileSystemWatcher(this);
+        connect(m_fallbackWatcher, &QFileSystemWatcher::directoryChanged, this,
+            [this](const QString &directory) {
+                if(QFileInfo(directory).isDir()) {
+                    // Pick up new subdirectories
+                    QDirIterator it(directory, QDir::Dirs | QDir::NoDotAndDotDot);
+                    while(it.hasNext()) {
+                        const QString subdirectory = QFileInfo(it.next()).canonicalFilePath();
+                        if(!m_watches.contains(subdirectory))
+                            watchTree(subdirectory);
+                    }
+                }
+                else {
+                    unwatchTree(directory);
+                }
+
+                directoryChanged(directory);
+            });
+    }
+
+    // Listing every directory of a large collection takes a while, so it's
+    // done on a worker thread.  Changes made before the watches are in place
+    // are left to the collection scan which runs at the same time.
+
+    const QStringList folders = m_folders;
+    const PathTrie scope = m_scope;
+    const int generation = ++m_generation;
+
+    auto listing = new QFutureWatcher<QStringList>(this);
+    connect(listing, &QFutureWatcher<QStringList>::finished, this, [this, listing, generation] {
+        listing->deleteLater();
+
+        if(generation != m_generation)
+            return;
+
+        addWatches(listing->result());
+        qCDebug(JUK_LOG) << "Watching" << m_watches.count() << "directories for changes";
+    });
+
+    listing->setFuture(QtConcurrent::run([folders, scope] {
+        QStringList directories;
+        for(const auto &folder : folders)
+            directories += listTree(folder, scope);
+        return directories;
+    }));
+}
+
+void LibraryWatcher::stopWatching()
+{
+    ++m_generation; // Drops a listing still running
+    m_reportTimer.stop();
+    m_firstPendingEvent.invalidate();
+    m_changedFiles.clear();
+    m_removedFiles.clear();
+    m_changedDirectories.clear();
+
+    m_watchedDirectories.clear();
+    m_watches.clear();
+    m_watchLimitReached = false;
+
+    delete m_fallbackWatcher;
+    m_fallbackWatcher = nullptr;
+
+    delete m_notifier;
+    m_notifier = nullptr;
+
+#ifdef Q_OS_LINUX
+    // Closing the descriptor removes all of its watches.
+    if(m_inotifyFd >= 0)
+        ::close(m_inotifyFd);
+#endif
+
+    m_inotifyFd = -1;
+}
+
+void LibraryWatcher::watchTree(const QString &directory)
+{
+    addWatches(listTree(directory, m_scope));
+}
+
+QStringList LibraryWatcher::listTree(const QString &directory, const PathTrie &scope) // static
+{
+    QStringList directories;
+    QStringList pending(directory);
+    QSet<QString> visited; // Symlinks can make loops
+
+    while(!pending.isEmpty()) {
+        const QString current = pending.takeLast();
+
+        if(current.isEmpty() || visited.contains(current) || scope.isExcluded(current))
+            continue;
+
+        visited.insert(current);
+        directories << current;
+
+        QDirIterator it(current, QDir::Dirs | QDir::NoDotAndDotDot);
+        while(it.hasNext())
+            pending << QFileInfo(it.next()).canonicalFilePath();
+    }
+
+    return directories;
+}
+
+void LibraryWatcher::addWatches(const QStringList &directories)
+{
+    for(const auto &directory : directories) {
+        if(m_watches.contains(directory))
+            continue;
+
+        if(m_fallbackWatcher) {
+            if(m_fallbackWatcher->addPath(directory))
+                m_watches.insert(directory, -1);
+            continue;
+        }
+
+#ifdef Q_OS_LINUX
+        const int watch = inotify_add_watch(m_inotifyFd,
+            QFile::encodeName(directory).constData(), INOTIFY_MASK);
+
+        if(watch < 0) {
+            if(errno == ENOSPC && !m_watchLimitReached) {
+                m_watchLimitReached = true;
+                qCWarning(JUK_LOG) << "Out of inotify watches, not all music folders are"
+                                   << "watched for changes. Consider raising"
+                                   << "fs.inotify.max_user_watches.";
+            }
+            continue;
+        }
+
+        m_watchedDirectories.insert(watch, directory);
+        m_watches.insert(directory, watch);
+#endif
+    }
+}
+
+void LibraryWatcher::unwatchTree(const QString &directory)
+{
+    const QString prefix = directory + QLatin1Char('/');
+
+    for(auto it = m_watches.begin(); it != m_watches.end(); ) {
+        if(it.key() != directory && !it.key().startsWith(prefix)) {
+            ++it;
+            continue;
+        }
+
+        if(m_fallbackWatcher) {
+            m_fallbackWatcher->removePath(it.key());
+        }
+#ifdef Q_OS_LINUX
+        else {
+            inotify_rm_watch(m_inotifyFd, it.value());
+            m_watchedDirectories.remove(it.value());
+        }
+#endif
+
+        it = m_watches.erase(it);
+    }
+}
+
+void LibraryWatcher::readEvents()
+{
+#ifdef Q_OS_LINUX
+    alignas(struct inotify_event) char buffer[16 * 1024];
+
+    for(;;) {
+        const ssize_t length = ::read(m_inotifyFd, buffer, sizeof(buffer));
+        if(length <= 0)
+            break;
+
+        for(const char *p = buffer; p < buffer + length; ) {
+            const auto *event = reinterpret_cast<const struct inotify_event *>(p);
+            p += sizeof(struct inotify_event) + event->len;
+
+            if(event->mask & IN_Q_OVERFLOW) {
+                qCWarning(JUK_LOG) << "Missed some changes to the music folders, checking them all";
+                for(const auto &folder : qAsConst(m_folders))
+                    directoryChanged(folder);
+                continue;
+            }
+
+            const QString directory = m_watchedDirectories.value(event->wd);
+            if(directory.isEmpty())
+                continue;
+
+            if(event->mask & IN_IGNORED) {
+                m_watchedDirectories.remove(event->wd);
+                if(m_watches.value(directory) == event->wd)
+                    m_watches.remove(directory);
+                continue;
+            }
+
+            // Other directories are handled through the events of their
+            // parents, but the music folders themselves have none.
+            if(event->len == 0) {
+                if((event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) && m_folders.contains(directory)) {
+                    unwatchTree(directory);
+                    directoryChanged(directory);
+                }
+                continue;
+            }
+
+            const QString path = directory + QLatin1Char('/') + QFile::decodeName(event->name);
+            if(m_scope.isExcluded(path))
+                continue;
+
+            if(event->mask & IN_ISDIR) {
+                if(event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    watchTree(path);
+                    directoryChanged(path);
+                }
+                else if(event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    unwatchTree(path);
+                    directoryChanged(path);
+                }
+            }
+            else if(event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                fileChanged(path);
+            }
+            else if(event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                fileRemoved(path);
+            }
+        }
+    }
+#endif
+}
+
+void LibraryWatcher::fileChanged(const QString &path)
+{
+    if(MediaFiles::classify(path) == MediaFiles::FileKind::Other)
+        return;
+
+    m_removedFiles.remove(path);
+    m_changedFiles.insert(path);
+    scheduleReport();
+}
+
+void LibraryWatcher::fileRemoved(const QString &path)
+{
+    m_changedFiles.remove(path);
+    m_removedFiles.insert(path);
+    scheduleReport();
+}
+
+void LibraryWatcher::directoryChanged(const QString &path)
+{
+    m_changedDirectories.insert(path);
+    scheduleReport();
+}
+
+void LibraryWatcher::scheduleReport()
+{
+    if(!m_firstPendingEvent.isValid())
+        m_firstPendingEvent.start();
+
+    const qint64 remaining = MAXIMUM_DELAY_MS - m_firstPendingEvent.elapsed();
+    m_reportTimer.start(int(qBound<qint64>(0, remaining, QUIET_PERIOD_MS)));
+}
+
+void LibraryWatcher::report()
+{
+    m_firstPendingEvent.invalidate();
+
+    const QStringList directories(m_changedDirectories.begin(), m_changedDirectories.end());
+    const QStringList changed(m_changedFiles.begin(), m_changedFiles.end());
+    const QStringList removed(m_removedFiles.begin(), m_removedFiles.end());
+
+    m_changedDirectories.clear();
+    m_changedFiles.clear();
+    m_removedFiles.clear();
+
+    qCDebug(JUK_LOG) << "Music folders changed:" << changed.count() << "files changed,"
+                     << removed.count() << "removed," << directories.count()
+                     << "directories to check";
+
+    if(!removed.isEmpty() || !changed.isEmpty())
+        emit filesChanged(changed, removed);
+
+    if(!directories.isEmpty())
+        emit directoriesChanged(directories);
+}
+
+// vim: set et sw=4 tw=0 sta:
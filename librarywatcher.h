@@ -0,0 +1,120 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JUK_LIBRARYWATCHER_H
+#define JUK_LIBRARYWATCHER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+#include "pathtrie.h"
+
+class QFileSystemWatcher;
+class QSocketNotifier;
+
+/**
+ * Watches the music folders for changes made by other programs.  Only the
+ * directories are tracked, nothing is kept per file.
+ *
+ * Events are coalesced: a burst of changes, such as a download finishing or
+ * a tagger rewriting a whole album, is reported as one batch once the folders
+ * have been quiet for a moment, with each affected file listed once.
+ *
+ * On Linux inotify is used directly, which reports the individual files.
+ * Elsewhere only the directories that changed are known.
+ */
+class LibraryWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LibraryWatcher(QObject *parent = nullptr);
+    virtual ~LibraryWatcher();
+
+    /**
+     * Watches \a folders and all their subdirectories except for those
+     * excluded by \a scope.
+     */
+    void setFolders(const QStringList &folders, const PathTrie &scope);
+
+    /**
+     * Starts or stops watching.  Changes made while stopped are not
+     * reported.
+     */
+    void setEnabled(bool enable);
+    bool isEnabled() const { return m_enabled; }
+
+signals:
+    /**
+     * Media or playlist files in \a changed were created, rewritten or moved
+     * into a watched folder and the files in \a removed were deleted or moved
+     * away.
+     */
+    void filesChanged(const QStringList &changed, const QStringList &removed);
+
+    /**
+     * Something changed within \a directories (recursively) which couldn't
+     * be tracked per file, for instance a whole directory being moved in or
+     * out, and they need to be checked again.
+     */
+    void directoriesChanged(const QStringList &directories);
+
+private slots:
+    void readEvents();
+
+private:
+    void startWatching();
+    void stopWatching();
+
+    void watchTree(const QString &directory);
+    void unwatchTree(const QString &directory);
+    void addWatches(const QStringList &directories);
+
+    static QStringList listTree(const QString &directory, const PathTrie &scope);
+
+    void fileChanged(const QString &path);
+    void fileRemoved(const QString &path);
+    void directoryChanged(const QString &path);
+    void scheduleReport();
+    void report();
+
+    QStringList m_folders;
+    PathTrie m_scope;
+    bool m_enabled = false;
+
+    int m_inotifyFd = -1;
+    QSocketNotifier *m_notifier = nullptr;
+    QFileSystemWatcher *m_fallbackWatcher = nullptr;
+
+    QHash<int, QString> m_watchedDirectories; // inotify watch -> directory
+    QHash<QString, int> m_watches;            // directory -> inotify watch
+    bool m_watchLimitReached = false;
+    int m_generation = 0;
+
+    QSet<QString> m_changedFiles;
+    QSet<QString> m_removedFiles;
+    QSet<QString> m_changedDirectories;
+    QTimer m_reportTimer;
+    QElapsedTimer m_firstPendingEvent;
+};
+
+#endif
+
+// vim: set et sw=4 tw=0 sta:
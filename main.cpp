@@ -28,10 +28,14 @@
 #include <QCommandLineParser>
 
 #include "juk.h"
+#include "startuptimeline.h"
 #include <config-juk.h>
 
 int main(int argc, char *argv[])
 {
+    // Start the clock for the startup phases as early as we can.
+    StartupTimeline::instance();
+
     QApplication a(argc, argv);
     KLocalizedString::setApplicationDomain("juk");
 
@@ -67,9 +71,16 @@ int main(int argc, char *argv[])
     QCommandLineParser parser;
     aboutData.setupCommandLine(&parser);
     parser.addPositionalArgument(QLatin1String("[file(s)]"), i18n("File(s) to open"));
+
+    QCommandLineOption startupProfileOption(QStringLiteral("startup-profile"),
+        i18n("Print how long each phase of starting up took once the music folders are scanned"));
+    parser.addOption(startupProfileOption);
+
     parser.process(a);
     aboutData.processCommandLine(&parser);
 
+    StartupTimeline::instance()->setPrintWhenFinished(parser.isSet(startupProfileOption));
+
     KCrash::initialize();
 
     // Create the main window and such
@@ -27,6 +27,10 @@
 #include <QStandardPaths>
 #include <QMimeType>
 #include <QMimeDatabase>
+#include <QHash>
+#include <QSet>
+
+#include <atomic>
 
 #include <taglib.h>
 #include <taglib_config.h>
@@ -44,8 +48,6 @@
 #include "juk_debug.h"
 
 namespace MediaFiles {
-    static QStringList savedMimeTypes;
-
     static const char mp3Type[]  = "audio/mpeg";
     static const char oggType[]  = "audio/ogg";
     static const char flacType[] = "audio/x-flac";
@@ -74,6 +76,73 @@ namespace MediaFiles {
 
 #define ARRAY_SIZE(arr) (sizeof(arr)/sizeof(arr[0]))
 
+namespace {
+    /**
+     * Maps lower-case file extensions to the kind of file any mime type using
+     * that extension is.  Extensions used by mime types of different kinds
+     * are kept apart so that those files are still sniffed.
+     */
+    struct ExtensionTable {
+        QHash<QString, MediaFiles::FileKind> kinds;
+        QSet<QString> ambiguous;
+    };
+
+    std::atomic<quint64> classifiedByExtension(0);
+    std::atomic<quint64> classifiedBySniffing(0);
+}
+
+static MediaFiles::FileKind kindOfMimeType(const QMimeType &mimeType)
+{
+    if(!mimeType.isValid())
+        return MediaFiles::FileKind::Other;
+
+    if(mimeType.inherits(QLatin1String(MediaFiles::m3uType)))
+        return MediaFiles::FileKind::Playlist;
+
+    for(unsigned i = 0; i < ARRAY_SIZE(MediaFiles::mediaTypes); ++i) {
+        if(mimeType.inherits(QLatin1String(MediaFiles::mediaTypes[i])))
+            return MediaFiles::FileKind::Media;
+    }
+
+    return MediaFiles::FileKind::Other;
+}
+
+static const ExtensionTable &extensionTable()
+{
+    static const ExtensionTable table = [] {
+        ExtensionTable result;
+        QMimeDatabase db;
+
+        const auto allMimeTypes = db.allMimeTypes();
+        for(const auto &mimeType : allMimeTypes) {
+            const auto kind = kindOfMimeType(mimeType);
+            const auto suffixes = mimeType.suffixes();
+
+            for(const auto &suffix : suffixes) {
+                const QString extension = suffix.toLower();
+
+                // Compound suffixes such as tar.gz can't be looked up by the
+                // last extension alone.
+                if(extension.contains(QLatin1Char('.')) || result.ambiguous.contains(extension))
+                    continue;
+
+                const auto it = result.kinds.constFind(extension);
+                if(it == result.kinds.constEnd()) {
+                    result.kinds.insert(extension, kind);
+                }
+                else if(*it != kind) {
+                    result.kinds.remove(extension);
+                    result.ambiguous.insert(extension);
+                }
+            }
+        }
+
+        return result;
+    }();
+
+    return table;
+}
+
 static QString getMusicDir()
 {
     const auto musicLocation =
@@ -120,7 +189,8 @@ QString MediaFiles::savePlaylistDialog(const QString &playlistName, QWidget *par
     return fileName;
 }
 
-TagLib::File *MediaFiles::fileFactoryByType(const QString &fileName)
+TagLib::File *MediaFiles::fileFactoryByType(const QString &fileName,
+                                            TagLib::AudioProperties::ReadStyle style)
 {
     QMimeDatabase db;
     QMimeType result = db.mimeTypeForFile(fileName);
@@ -131,44 +201,57 @@ TagLib::File *MediaFiles::fileFactoryByType(const QString &fileName)
     QByteArray encodedFileName(QFile::encodeName(fileName));
 
     if(result.inherits(QLatin1String(mp3Type)))
-        file = new TagLib::MPEG::File(encodedFileName.constData());
+        file = new TagLib::MPEG::File(encodedFileName.constData(), true, style);
     else if(result.inherits(QLatin1String(flacType)))
-        file = new TagLib::FLAC::File(encodedFileName.constData());
+        file = new TagLib::FLAC::File(encodedFileName.constData(), true, style);
     else if(result.inherits(QLatin1String(vorbisType)))
-        file = new TagLib::Vorbis::File(encodedFileName.constData());
+        file = new TagLib::Vorbis::File(encodedFileName.constData(), true, style);
     else if(result.inherits(QLatin1String(asfType)))
-        file = new TagLib::ASF::File(encodedFileName.constData());
+        file = new TagLib::ASF::File(encodedFileName.constData(), true, style);
     else if(result.inherits(QLatin1String(mp4Type)) || result.inherits(QLatin1String(mp4AudiobookType)))
-        file = new TagLib::MP4::File(encodedFileName.constData());
+        file = new TagLib::MP4::File(encodedFileName.constData(), true, style);
     else if(result.inherits(QLatin1String(mpcType)))
-        file = new TagLib::MPC::File(encodedFileName.constData());
+        file = new TagLib::MPC::File(encodedFileName.constData(), true, style);
     else if(result.inherits(QLatin1String(oggflacType)))
-        file = new TagLib::Ogg::FLAC::File(encodedFileName.constData());
+        file = new TagLib::Ogg::FLAC::File(encodedFileName.constData(), true, style);
     else if(result.inherits(QLatin1String(oggopusType)) ||
             (result.inherits(QLatin1String(oggType)) && fileName.endsWith(QLatin1String(".opus")))
             )
     {
-        file = new TagLib::Ogg::Opus::File(encodedFileName.constData());
+        file = new TagLib::Ogg::Opus::File(encodedFileName.constData(), true, style);
     }
 
     return file;
 }
 
-bool MediaFiles::isMediaFile(const QString &fileName)
+MediaFiles::FileKind MediaFiles::classify(const QString &fileName)
 {
-    QMimeDatabase db;
-    QMimeType result = db.mimeTypeForFile(fileName);
-    if(!result.isValid())
-        return false;
+    const int dot = fileName.lastIndexOf(QLatin1Char('.'));
 
-    // Search through our table of media types for a match
-    const auto validMimeTypes(mimeTypes());
-    for(const auto &mimeType : validMimeTypes) {
-        if(result.inherits(mimeType))
-            return true;
+    if(dot > fileName.lastIndexOf(QLatin1Char('/'))) {
+        const ExtensionTable &table = extensionTable();
+        const auto it = table.kinds.constFind(fileName.mid(dot + 1).toLower());
+
+        if(it != table.kinds.constEnd()) {
+            ++classifiedByExtension;
+            return *it;
+        }
     }
 
-    return false;
+    ++classifiedBySniffing;
+
+    QMimeDatabase db;
+    return kindOfMimeType(db.mimeTypeForFile(fileName));
+}
+
+MediaFiles::ClassifierStats MediaFiles::classifierStats()
+{
+    return { classifiedByExtension.load(), classifiedBySniffing.load() };
+}
+
+bool MediaFiles::isMediaFile(const QString &fileName)
+{
+    return classify(fileName) == FileKind::Media;
 }
 
 static bool isFileOfMimeType(const QString &fileName, const QString &mimeType)
@@ -180,7 +263,7 @@ static bool isFileOfMimeType(const QString &fileName, const QString &mimeType)
 
 bool MediaFiles::isPlaylistFile(const QString &fileName)
 {
-    return isFileOfMimeType(fileName, m3uType);
+    return classify(fileName) == FileKind::Playlist;
 }
 
 bool MediaFiles::isMP3(const QString &fileName)
@@ -225,12 +308,14 @@ bool MediaFiles::isOggFLAC(const QString &fileName)
 
 QStringList MediaFiles::mimeTypes()
 {
-    if(!savedMimeTypes.isEmpty())
-        return savedMimeTypes;
-
-    for(unsigned i = 0; i < ARRAY_SIZE(mediaTypes); ++i) {
-        savedMimeTypes << QLatin1String(mediaTypes[i]);
-    }
+    // Built once, the directory loaders call this from several threads.
+    static const QStringList savedMimeTypes = [] {
+        QStringList types;
+        for(unsigned i = 0; i < ARRAY_SIZE(mediaTypes); ++i) {
+            types << QLatin1String(mediaTypes[i]);
+        }
+        return types;
+    }();
 
     return savedMimeTypes;
 }
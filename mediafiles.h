@@ -29,6 +29,7 @@ namespace TagLib {
 }
 
 #include <taglib_config.h>
+#include <audioproperties.h>
 
 /**
  * A namespace for file JuK's file related functions.  The goal is to hide
@@ -51,9 +52,36 @@ namespace MediaFiles
     /**
      * Returns a pointer to a new appropriate subclass of TagLib::File, or
      * a null pointer if there is no appropriate subclass for the given
-     * file.
+     * file.  The audio properties are read with the given \a style.
      */
-    TagLib::File *fileFactoryByType(const QString &fileName);
+    TagLib::File *fileFactoryByType(const QString &fileName,
+        TagLib::AudioProperties::ReadStyle style = TagLib::AudioProperties::Average);
+
+    /**
+     * The kinds of file that classify() tells apart.
+     */
+    enum class FileKind {
+        Other,
+        Media,
+        Playlist
+    };
+
+    /**
+     * Returns the kind of file fileName is.  Most files are classified by
+     * their extension alone, the file contents are only read for extensions
+     * which are unknown or shared by media and non-media types.  Thread-safe.
+     */
+    FileKind classify(const QString &fileName);
+
+    /**
+     * Counts of the files classify() has handled since startup.
+     */
+    struct ClassifierStats {
+        quint64 byExtension;
+        quint64 sniffed;
+    };
+
+    ClassifierStats classifierStats();
 
     /**
      * Returns true if fileName is a supported media file.
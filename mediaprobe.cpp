@@ -0,0 +1,119 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mediaprobe.h"
+
+#include <tfile.h>
+#include <mpegfile.h>
+#include <mpegproperties.h>
+#include <xingheader.h>
+#include <id3v2tag.h>
+#include <flacfile.h>
+#include <vorbisfile.h>
+#include <oggflacfile.h>
+#include <opusfile.h>
+#include <xiphcomment.h>
+#include <asffile.h>
+#include <mp4file.h>
+#include <mp4tag.h>
+#include <mpcfile.h>
+
+#include "mediafiles.h"
+
+MediaProbe::MediaProbe(const QString &fileName, TagLib::AudioProperties::ReadStyle style) :
+    m_fileName(fileName),
+    m_file(MediaFiles::fileFactoryByType(fileName, style)),
+    m_format(UnknownFormat),
+    m_style(style)
+{
+    TagLib::File *file = m_file.get();
+
+    if(dynamic_cast<TagLib::MPEG::File *>(file))
+        m_format = MPEG;
+    else if(dynamic_cast<TagLib::FLAC::File *>(file))
+        m_format = FLAC;
+    else if(dynamic_cast<TagLib::Vorbis::File *>(file))
+        m_format = OggVorbis;
+    else if(dynamic_cast<TagLib::Ogg::FLAC::File *>(file))
+        m_format = OggFLAC;
+    else if(dynamic_cast<TagLib::Ogg::Opus::File *>(file))
+        m_format = OggOpus;
+    else if(dynamic_cast<TagLib::ASF::File *>(file))
+        m_format = ASF;
+    else if(dynamic_cast<TagLib::MP4::File *>(file))
+        m_format = MP4;
+    else if(dynamic_cast<TagLib::MPC::File *>(file))
+        m_format = MPC;
+}
+
+MediaProbe::~MediaProbe() = default;
+
+bool MediaProbe::isValid() const
+{
+    return m_file && m_file->isValid();
+}
+
+bool MediaProbe::hasEmbeddedArt() const
+{
+    if(!isValid())
+        return false;
+
+    switch(m_format) {
+    case MPEG: {
+        auto *mpegFile = static_cast<TagLib::MPEG::File *>(m_file.get());
+        TagLib::ID3v2::Tag *id3tag = mpegFile->ID3v2Tag(false);
+
+        // Plenty of MP3s only have an ID3v1 tag, which can't hold pictures.
+
+        if(!id3tag)
+            return false;
+
+        // Look for attached picture frames.
+        return !id3tag->frameListMap()["APIC"].isEmpty();
+    }
+    case FLAC:
+        return !static_cast<TagLib::FLAC::File *>(m_file.get())->pictureList().isEmpty();
+    case OggVorbis:
+    case OggFLAC:
+    case OggOpus: {
+        auto *oggTag = dynamic_cast<TagLib::Ogg::XiphComment *>(m_file->tag());
+        return oggTag && !oggTag->pictureList().isEmpty();
+    }
+    case MP4: {
+        TagLib::MP4::Tag *tag = static_cast<TagLib::MP4::File *>(m_file.get())->tag();
+        return tag && tag->contains("covr");
+    }
+    default:
+        return false;
+    }
+}
+
+bool MediaProbe::hasEstimatedProperties() const
+{
+    if(m_style != TagLib::AudioProperties::Fast || !isValid() || m_format != MPEG)
+        return false;
+
+    // Without a Xing or VBRI header the length and bitrate of an MP3 are
+    // worked out from its first frame, which is only right for CBR files.
+    // TagLib reads the other formats the same way whatever the read style.
+
+    const TagLib::MPEG::Properties *properties =
+        static_cast<TagLib::MPEG::File *>(m_file.get())->audioProperties();
+
+    return properties && !properties->xingHeader();
+}
+
+// vim: set et sw=4 tw=0 sta:
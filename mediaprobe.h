@@ -0,0 +1,98 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JUK_MEDIAPROBE_H
+#define JUK_MEDIAPROBE_H
+
+#include <QString>
+
+#include <audioproperties.h>
+
+#include <memory>
+
+namespace TagLib { class File; }
+
+/**
+ * The result of opening an audio file once: its detected format and the
+ * TagLib::File parsed from it.  The tag, audio property and embedded art
+ * readers all work from the same probe so that a file being scanned is only
+ * detected and parsed one time.
+ *
+ * A probe owns its TagLib::File, so separate probes may be used from
+ * separate threads.
+ */
+class MediaProbe
+{
+public:
+    enum Format {
+        UnknownFormat,
+        MPEG,
+        FLAC,
+        OggVorbis,
+        OggFLAC,
+        OggOpus,
+        ASF,
+        MP4,
+        MPC
+    };
+
+    /**
+     * Opens \a fileName, reading its audio properties with the given
+     * \a style.
+     */
+    explicit MediaProbe(const QString &fileName,
+        TagLib::AudioProperties::ReadStyle style = TagLib::AudioProperties::Average);
+    ~MediaProbe();
+
+    MediaProbe(const MediaProbe &) = delete;
+    MediaProbe &operator=(const MediaProbe &) = delete;
+
+    QString fileName() const { return m_fileName; }
+    Format format() const { return m_format; }
+
+    /**
+     * Returns the parsed file, or a null pointer if the file is of no
+     * supported format.  Remains owned by the probe.
+     */
+    TagLib::File *file() const { return m_file.get(); }
+
+    /**
+     * Returns true if the file could be parsed.
+     */
+    bool isValid() const;
+
+    /**
+     * Returns true if album art is embedded in the file's tags.
+     */
+    bool hasEmbeddedArt() const;
+
+    /**
+     * Returns true if the length and bitrate of the file may be estimates,
+     * which is the case for MP3 files without a Xing or VBRI header read
+     * with the Fast read style.
+     */
+    bool hasEstimatedProperties() const;
+
+private:
+    QString m_fileName;
+    std::unique_ptr<TagLib::File> m_file;
+    Format m_format;
+    TagLib::AudioProperties::ReadStyle m_style;
+};
+
+#endif
+
+// vim: set et sw=4 tw=0 sta:
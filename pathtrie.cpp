@@ -0,0 +1,85 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pathtrie.h"
+
+PathTrie::PathTrie() : m_nodes(1)
+{
+}
+
+PathTrie::PathTrie(const QStringList &included, const QStringList &excluded) : PathTrie()
+{
+    for(const auto &path : included)
+        insert(path, Include);
+    for(const auto &path : excluded)
+        insert(path, Exclude);
+}
+
+void PathTrie::insert(const QString &path, Rule rule)
+{
+    int node = 0;
+
+    for(const auto &component : path.split(QLatin1Char('/'), Qt::SkipEmptyParts)) {
+        int child = m_nodes[node].children.value(component, -1);
+
+        if(child < 0) {
+            child = m_nodes.count();
+            m_nodes[node].children.insert(component, child);
+            m_nodes.append(Node());
+        }
+
+        node = child;
+    }
+
+    m_nodes[node].rule = rule;
+}
+
+void PathTrie::clear()
+{
+    m_nodes = QVector<Node>(1);
+}
+
+PathTrie::Rule PathTrie::ruleFor(const QString &path) const
+{
+    const QChar *data = path.constData();
+    const int length = path.length();
+
+    int node = 0;
+    Rule rule = m_nodes[node].rule;
+
+    for(int start = 0; start < length; ) {
+        int end = path.indexOf(QLatin1Char('/'), start);
+        if(end < 0)
+            end = length;
+
+        if(end > start) {
+            // Looks the component up without copying it.
+            const QString component = QString::fromRawData(data + start, end - start);
+            node = m_nodes[node].children.value(component, -1);
+
+            if(node < 0)
+                break;
+            if(m_nodes[node].rule != NoRule)
+                rule = m_nodes[node].rule;
+        }
+
+        start = end + 1;
+    }
+
+    return rule;
+}
+
+// vim: set et sw=4 tw=0 sta:
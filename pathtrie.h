@@ -0,0 +1,85 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JUK_PATHTRIE_H
+#define JUK_PATHTRIE_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * The music folders and the folders excluded from them, kept as a tree of
+ * path components so that whether a path is in scope takes time in the
+ * depth of the path, no matter how many folders there are.  The rule of the
+ * deepest folder containing a path applies, so an excluded folder can have
+ * an included folder within it again.
+ *
+ * Paths are expected to be absolute and canonical.  A PathTrie is implicitly
+ * shared and may be read from several threads once it's set up.
+ */
+class PathTrie
+{
+public:
+    enum Rule {
+        NoRule,
+        Include,
+        Exclude
+    };
+
+    PathTrie();
+    PathTrie(const QStringList &included, const QStringList &excluded);
+
+    /**
+     * Applies \a rule to \a path and everything within it.  A later rule for
+     * the same path replaces the earlier one.
+     */
+    void insert(const QString &path, Rule rule);
+
+    void clear();
+    bool isEmpty() const { return m_nodes.count() == 1 && m_nodes.first().rule == NoRule; }
+
+    /**
+     * Returns the rule of the deepest folder that is or contains \a path.
+     */
+    Rule ruleFor(const QString &path) const;
+
+    /**
+     * Returns true if \a path is within an included folder and not excluded.
+     */
+    bool contains(const QString &path) const { return ruleFor(path) == Include; }
+
+    /**
+     * Returns true if \a path is within an excluded folder, in which case
+     * everything below it is too, unless included again.  Scans use this to
+     * skip whole directories before listing them.
+     */
+    bool isExcluded(const QString &path) const { return ruleFor(path) == Exclude; }
+
+private:
+    struct Node
+    {
+        QHash<QString, int> children;
+        Rule rule = NoRule;
+    };
+
+    QVector<Node> m_nodes; // The root is first
+};
+
+#endif
+
+// vim: set et sw=4 tw=0 sta:
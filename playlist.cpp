@@ -71,6 +71,7 @@
 #include "coverdialog.h"
 #include "coverinfo.h"
 #include "deletedialog.h"
+#include "directoryindex.h"
 #include "directoryloader.h"
 #include "filerenamer.h"
 #include "iconsupport.h"
@@ -81,6 +82,7 @@
 #include "playlistitem.h"
 #include "playlistsearch.h"
 #include "playlistsharedsettings.h"
+#include "startuptimeline.h"
 #include "tagtransactionmanager.h"
 #include "upcomingplaylist.h"
 #include "webimagefetcher.h"
@@ -427,6 +429,11 @@ PlaylistItem *Playlist::firstChild() const
     return static_cast<PlaylistItem *>(topLevelItem(0));
 }
 
+PlaylistItem *Playlist::playlistItemFromIndex(const QModelIndex &index) const
+{
+    return static_cast<PlaylistItem *>(itemFromIndex(index));
+}
+
 void Playlist::updateLeftColumn()
 {
     int newLeftColumn = leftMostVisibleColumn();
@@ -1117,27 +1124,15 @@ void Playlist::read(QDataStream &s)
     // Do not sort. Add the files in the order they were saved.
     setSortingEnabled(false);
 
-    QStringList files;
-    s >> files;
+    const FileHandleList files = Cache::instance()->readPlaylistTracks(s);
 
     QTreeWidgetItem *after = 0;
-    const CollectionList *clInst = CollectionList::instance();
 
     m_blockDataChanged = true;
 
-    for(const auto &file : qAsConst(files)) {
-        if(file.isEmpty())
-            throw BICStreamException();
-
-        const auto &cItem = clInst->lookup(file);
-        if(cItem) {
-            // Reuse FileHandle so the playlist doesn't force TagLib to read it
-            // from disk
-            after = createItem(cItem->file(), after);
-        }
-        else {
-            after = createItem(FileHandle(file), after);
-        }
+    for(const auto &file : files) {
+        if(!file.isNull())
+            after = createItem(file, after);
     }
 
     m_blockDataChanged = false;
@@ -1237,6 +1232,9 @@ void Playlist::addFiles(const QStringList &files, PlaylistItem *after)
         return;
     }
 
+    if(this == CollectionList::instance() && !pendingFutures.isEmpty())
+        CollectionList::instance()->startScanCheckpoints(m_collection->folders());
+
     // Build handlers for all the still-active loaders on the heap and then
     // return to the event loop.
     for(const auto &future : qAsConst(pendingFutures)) {
@@ -1804,7 +1802,17 @@ void Playlist::addPlaylistFile(const QString &m3uFile)
 
 QFuture<void> Playlist::addFilesFromDirectory(const QString &dirPath)
 {
-    auto loader = new DirectoryLoader(dirPath);
+    // Only the collection knows whether the tracks of a directory are already
+    // loaded, other playlists always need the full listing.
+    DirectoryIndex *index = nullptr;
+    if(this == CollectionList::instance())
+        index = DirectoryIndex::instance();
+
+    auto loader = new DirectoryLoader(dirPath, index);
+    loader->setFolderScope(m_collection->folderScope());
+
+    const KConfigGroup config(KSharedConfig::openConfig(), "Scanning");
+    loader->setReadaheadDepth(config.readEntry("ReadaheadDepth", 64));
 
     connect(loader, &DirectoryLoader::loadedPlaylist, this,
         [this](const QString &m3uFile) {
@@ -1819,12 +1827,14 @@ QFuture<void> Playlist::addFilesFromDirectory(const QString &dirPath)
         }
     );
 
-    auto future = QtConcurrent::run(loader, &DirectoryLoader::startLoading);
+    // Finishes once the last files have been inserted.
+    auto future = loader->start();
     auto loadWatcher = new QFutureWatcher<void>(this);
     connect(loadWatcher, &QFutureWatcher<void>::finished, this, [=]() {
             loader->deleteLater();
             loadWatcher->deleteLater();
         });
+    loadWatcher->setFuture(future);
 
     return future;
 }
@@ -1852,16 +1862,8 @@ QFuture<void> Playlist::addUntypedFile(const QString &file, PlaylistItem *after)
         return {};
     }
 
-    if(fileInfo.isDir()) {
-        const auto blockedPaths = m_collection->excludedFolders();
-        if(std::none_of(blockedPaths.begin(), blockedPaths.end(),
-            [canonicalPath](const auto &dir) {
-                return canonicalPath.startsWith(dir);
-            }))
-        {
-            return addFilesFromDirectory(canonicalPath);
-        }
-    }
+    if(fileInfo.isDir() && !m_collection->folderScope().isExcluded(canonicalPath))
+        return addFilesFromDirectory(canonicalPath);
 
     return {};
 }
@@ -1887,6 +1889,12 @@ void Playlist::cleanupAfterAllFileLoadsCompleted()
     }
 
     playlistItemsChanged();
+
+    if(this == CollectionList::instance()) {
+        CollectionList::instance()->stopScanCheckpoints();
+        DirectoryIndex::instance()->save(m_collection->folders());
+        StartupTimeline::instance()->end(StartupTimeline::FolderScan, count());
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -2286,7 +2294,7 @@ QDataStream &operator<<(QDataStream &s, const Playlist &p)
 {
     s << p.name();
     s << p.fileName();
-    s << p.files();
+    Cache::instance()->writePlaylistTracks(s, const_cast<Playlist *>(&p)->items());
 
     return s;
 }
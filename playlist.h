@@ -156,6 +156,11 @@ public:
      */
     PlaylistItem *firstChild() const;
 
+    /**
+     * Returns the item at \a index of the playlist's model().
+     */
+    PlaylistItem *playlistItemFromIndex(const QModelIndex &index) const;
+
     /**
      * Allow duplicate files in the playlist.
      */
@@ -28,7 +28,6 @@
 #include <QAction>
 #include <QDragLeaveEvent>
 #include <QDragMoveEvent>
-#include <QElapsedTimer>
 #include <QFileInfo>
 #include <QHeaderView>
 #include <QIcon>
@@ -49,6 +48,7 @@
 #include "playermanager.h"
 #include "playlist.h"
 #include "searchplaylist.h"
+#include "startuptimeline.h"
 #include "tagtransactionmanager.h"
 #include "treeviewitemplaylist.h"
 #include "upcomingplaylist.h"
@@ -685,12 +685,11 @@ void PlaylistBox::setupUpcomingPlaylist()
 void PlaylistBox::slotLoadCachedPlaylists()
 {
     qCDebug(JUK_LOG) << "Loading cached playlists.";
-    QElapsedTimer stopwatch;
-    stopwatch.start();
+    StartupTimeline::instance()->begin(StartupTimeline::PlaylistRestore);
 
     Cache::loadPlaylists(this);
 
-    qCDebug(JUK_LOG) << "Cached playlists loaded, took" << stopwatch.elapsed() << "ms";
+    StartupTimeline::instance()->end(StartupTimeline::PlaylistRestore, playlists().count());
 
     // Auto-save playlists after they change.
     m_savePlaylistTimer = new QTimer(this);
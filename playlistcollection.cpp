@@ -26,13 +26,11 @@
 #include <kactionmenu.h>
 #include <kconfiggroup.h>
 #include <KSharedConfig>
-#include <kfileitem.h>
 
 #include <config-juk.h>
 
 #include <QAction>
 #include <QIcon>
-#include <QMutableListIterator>
 #include <QObject>
 #include <QPixmap>
 #include <QDir>
@@ -55,6 +53,7 @@
 #include "mediafiles.h"
 #include "playermanager.h"
 #include "searchplaylist.h"
+#include "startuptimeline.h"
 #include "upcomingplaylist.h"
 
 //Laurent: readd it
@@ -385,7 +384,6 @@ void PlaylistCollection::addFolder()
     DirectoryList l(m_folderList, m_excludedFolderList, m_importPlaylists, JuK::JuKInstance());
 
     if(l.exec() == QDialog::Accepted) {
-        m_dirLister.blockSignals(true);
         DirectoryList::Result result = l.dialogResult();
 
         const bool reload = m_importPlaylists != result.addPlaylists;
@@ -394,15 +392,15 @@ void PlaylistCollection::addFolder()
         m_excludedFolderList = canonicalizeFolderPaths(result.excludedDirs);
 
         foreach(const QString &dir, result.addedDirs) {
-            m_dirLister.openUrl(QUrl::fromLocalFile(dir), KDirLister::Keep);
             m_folderList.append(dir);
         }
 
         foreach(const QString &dir, result.removedDirs) {
-            m_dirLister.stop(QUrl::fromLocalFile(dir));
             m_folderList.removeAll(dir);
         }
 
+        updateFolderScope();
+
         if(reload) {
             open(m_folderList);
         }
@@ -411,8 +409,6 @@ void PlaylistCollection::addFolder()
         }
 
         saveConfig();
-
-        m_dirLister.blockSignals(false);
     }
 }
 
@@ -536,6 +532,12 @@ void PlaylistCollection::scanFolders()
     if(m_folderList.count() == 0)
         addFolder();
 
+    StartupTimeline::instance()->begin(StartupTimeline::FolderScan);
+
+    // Nothing to wait for if there are no folders, the scan is done.
+    if(m_folderList.isEmpty())
+        StartupTimeline::instance()->end(StartupTimeline::FolderScan);
+
     CollectionList::instance()->addFiles(m_folderList);
 
     enableDirWatch(true);
@@ -759,17 +761,15 @@ void PlaylistCollection::enableDirWatch(bool enable)
 {
     auto collection = CollectionList::instance();
 
-    m_dirLister.disconnect(collectionActions());
+    m_libraryWatcher.disconnect(collection);
     if(enable) {
-        QObject::connect(&m_dirLister, &KDirLister::newItems,
-                collectionActions(), [this](const KFileItemList &items) {
-                    this->newItems(items);
-                });
-        QObject::connect(&m_dirLister, &KDirLister::refreshItems,
-                collection, &CollectionList::slotRefreshItems);
-        QObject::connect(&m_dirLister, &KDirLister::itemsDeleted,
-                collection, &CollectionList::slotDeleteItems);
+        QObject::connect(&m_libraryWatcher, &LibraryWatcher::filesChanged,
+                collection, &CollectionList::slotFilesChanged);
+        QObject::connect(&m_libraryWatcher, &LibraryWatcher::directoriesChanged,
+                collection, &CollectionList::slotDirectoriesChanged);
     }
+
+    m_libraryWatcher.setEnabled(enable);
 }
 
 QString PlaylistCollection::playlistNameDialog(const QString &caption,
@@ -832,20 +832,6 @@ void PlaylistCollection::removeFileFromDict(const QString &file)
     m_playlistFiles.remove(file);
 }
 
-void PlaylistCollection::dirChanged(const QString &path)
-{
-    QString canonicalPath = QDir(path).canonicalPath();
-    if(canonicalPath.isEmpty())
-        return;
-
-    foreach(const QString &excludedFolder, m_excludedFolderList) {
-        if(canonicalPath.startsWith(excludedFolder))
-            return;
-    }
-
-    CollectionList::instance()->addFiles(QStringList(canonicalPath));
-}
-
 Playlist *PlaylistCollection::playlistByName(const QString &name) const
 {
     for(int i = 0; i < m_playlistStack->count(); ++i) {
@@ -857,32 +843,6 @@ Playlist *PlaylistCollection::playlistByName(const QString &name) const
     return 0;
 }
 
-void PlaylistCollection::newItems(const KFileItemList &list) const
-{
-    // Make fast-path for the normal case
-    if(m_excludedFolderList.isEmpty()) {
-        CollectionList::instance()->slotNewItems(list);
-        return;
-    }
-
-    // Slow case: Directories to exclude from consideration
-
-    KFileItemList filteredList(list);
-
-    foreach(const QString &excludedFolder, m_excludedFolderList) {
-        QMutableListIterator<KFileItem> filteredListIterator(filteredList);
-
-        while(filteredListIterator.hasNext()) {
-            const KFileItem fileItem = filteredListIterator.next();
-
-            if(fileItem.url().path().startsWith(excludedFolder))
-                filteredListIterator.remove();
-        }
-    }
-
-    CollectionList::instance()->slotNewItems(filteredList);
-}
-
 ////////////////////////////////////////////////////////////////////////////////
 // private methods
 ////////////////////////////////////////////////////////////////////////////////
@@ -896,9 +856,7 @@ void PlaylistCollection::readConfig()
     m_excludedFolderList = canonicalizeFolderPaths(
             config.readEntry("ExcludeDirectoryList", QStringList()));
 
-    for(const auto &folder : qAsConst(m_folderList)) {
-        m_dirLister.openUrl(QUrl::fromUserInput(folder), KDirLister::Keep);
-    }
+    updateFolderScope();
 }
 
 void PlaylistCollection::saveConfig()
@@ -912,6 +870,12 @@ void PlaylistCollection::saveConfig()
     config.sync();
 }
 
+void PlaylistCollection::updateFolderScope()
+{
+    m_folderScope = PathTrie(canonicalizeFolderPaths(m_folderList), m_excludedFolderList);
+    m_libraryWatcher.setFolders(m_folderList, m_folderScope);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // ActionHandler implementation
 ////////////////////////////////////////////////////////////////////////////////
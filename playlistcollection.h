@@ -19,8 +19,9 @@
 
 #include "stringhash.h"
 #include "playlistinterface.h"
+#include "librarywatcher.h"
+#include "pathtrie.h"
 
-#include <KDirLister>
 #include <KLocalizedString>
 
 #include <QPointer>
@@ -136,15 +137,11 @@ public:
     UpcomingPlaylist *upcomingPlaylist() const;
     void setUpcomingPlaylistEnabled(bool enable);
 
-    void dirChanged(const QString &path);
-
     /**
      * Returns a pointer to the action handler.
      */
     ActionHandler *collectionActions() const;
 
-    void newItems(const KFileItemList &list) const;
-
     /**
      * This is the current playlist in all things relating to the player.  It
      * represents the playlist that either should be played from or is currently
@@ -179,6 +176,17 @@ public:
      */
     QStringList excludedFolders() const { return m_excludedFolderList; }
 
+    /**
+     * @return list of folders scanned for music at startup.
+     */
+    QStringList folders() const { return m_folderList; }
+
+    /**
+     * @return the folders() and excludedFolders() for telling quickly
+     * whether a path is one that automatic searching should cover.
+     */
+    const PathTrie &folderScope() const { return m_folderScope; }
+
 protected:
     virtual QStackedWidget *playlistStack() const;
     virtual void setupPlaylist(Playlist *playlist, const QString &iconName);
@@ -201,6 +209,7 @@ protected:
 private:
     void readConfig();
     void saveConfig();
+    void updateFolderScope();
 
     QStackedWidget   *m_playlistStack;
     HistoryPlaylist  *m_historyPlaylist;
@@ -208,11 +217,12 @@ private:
     ActionHandler    *m_actionHandler;
     PlayerManager    *m_playerManager;
 
-    KDirLister  m_dirLister;
+    LibraryWatcher m_libraryWatcher;
     StringHash  m_playlistNames;
     StringHash  m_playlistFiles;
     QStringList m_folderList;
     QStringList m_excludedFolderList;
+    PathTrie    m_folderScope;
     bool        m_importPlaylists;
     bool        m_searchEnabled;
     bool        m_playing;
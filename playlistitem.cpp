@@ -23,11 +23,13 @@
 #include <QCollator>
 #include <QFileInfo>
 #include <QHeaderView>
+#include <QWriteLocker>
 
 #include "collectionlist.h"
 #include "juktag.h"
 #include "coverinfo.h"
 #include "covermanager.h"
+#include "searchkernel.h"
 #include "tagtransactionmanager.h"
 
 #include "juk_debug.h"
@@ -73,14 +75,29 @@ PlaylistItem::~PlaylistItem()
 void PlaylistItem::setFile(const FileHandle &file)
 {
     m_collectionItem->updateCollectionDict(d->fileHandle.absFilePath(), file.absFilePath());
-    d->fileHandle = file;
+
+    // A reread handle is still the same track as far as the collection is
+    // concerned.
+    FileHandle newFile(file);
+    if(newFile.cacheId() == 0)
+        newFile.setCacheId(d->fileHandle.cacheId());
+
+    // CollectionList::lookupFile() copies the handle on other threads.
+    {
+        QWriteLocker lock(&CollectionList::instance()->m_itemsDictLock);
+        d->fileHandle = newFile;
+    }
+
     refresh();
 }
 
 void PlaylistItem::setFile(const QString &file)
 {
     QString oldPath = d->fileHandle.absFilePath();
-    d->fileHandle.setFile(file);
+    {
+        QWriteLocker lock(&CollectionList::instance()->m_itemsDictLock);
+        d->fileHandle.setFile(file);
+    }
     m_collectionItem->updateCollectionDict(oldPath, d->fileHandle.absFilePath());
     refresh();
 }
@@ -131,6 +148,35 @@ QString PlaylistItem::text(int column) const
     }
 }
 
+QVariant PlaylistItem::data(int column, int role) const
+{
+    // The comment isn't stored in the item, so that it's only decoded from
+    // the cache when it's actually shown or searched.
+
+    if((role == Qt::DisplayRole || role == Qt::EditRole) && d && treeWidget() &&
+       column - playlist()->columnOffset() == CommentColumn)
+    {
+        return text(column);
+    }
+
+    return QTreeWidgetItem::data(column, role);
+}
+
+QString PlaylistItem::foldedText(int column) const
+{
+    const int id = column - playlist()->columnOffset();
+
+    // See CollectionListItem::refresh() for which columns are kept.
+
+    if(!d || id < 0 || id >= d->metadata.size() ||
+       id == TrackNumberColumn || id == LengthColumn || id == CommentColumn)
+    {
+        return SearchKernel::fold(data(column, Qt::DisplayRole).toString());
+    }
+
+    return d->metadata[id];
+}
+
 void PlaylistItem::setText(int column, const QString &text)
 {
     QTreeWidgetItem::setText(column, text);
@@ -337,6 +383,9 @@ int PlaylistItem::compare(const PlaylistItem *firstItem, const PlaylistItem *sec
         else
             return 1;
         break;
+    case CommentColumn:
+        return naturalCompare(firstItem->d->fileHandle.tag()->comment().toLower(),
+                              secondItem->d->fileHandle.tag()->comment().toLower());
     default:
         return naturalCompare(firstItem->d->metadata[column - offset],
                               secondItem->d->metadata[column - offset]);
@@ -375,7 +424,8 @@ void PlaylistItem::setup(CollectionListItem *item)
     int columns = lastColumn() + offset + 1;
 
     for(int i = offset; i < columns; i++) {
-        setText(i, text(i));
+        if(i - offset != CommentColumn)
+            setText(i, text(i));
     }
 }
 
@@ -96,8 +96,16 @@ public:
     FileHandle file() const;
 
     virtual QString text(int column) const;
+    virtual QVariant data(int column, int role) const override;
     virtual void setText(int column, const QString &text);
 
+    /**
+     * Returns the text of \a column case folded for searching.  This is kept
+     * along with the text for most columns, and folded on the fly for the
+     * others.
+     */
+    QString foldedText(int column) const;
+
     bool isPlaying() const;
     void setPlaying(bool playing = true, bool master = true);
 
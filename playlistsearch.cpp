@@ -22,6 +22,9 @@
 #include "playlist.h"
 #include "playlistitem.h"
 #include "collectionlist.h"
+#include "searchcandidates.h"
+#include "searchindex.h"
+#include "searchkernel.h"
 #include "juk-exception.h"
 
 #include "juk_debug.h"
@@ -46,10 +49,12 @@ PlaylistSearch::PlaylistSearch(const PlaylistList &playlists,
     m_components(components),
     m_mode(mode)
 {
+    updateCandidates();
+
     QConcatenateTablesProxyModel* const model = new QConcatenateTablesProxyModel(this);
     for(Playlist* playlist : playlists)
         model->addSourceModel(playlist->model());
-    setSourceModel(model);
+    setPlaylistsModel(model);
 }
 
 bool PlaylistSearch::checkItem(QModelIndex *item)
@@ -68,11 +73,14 @@ void PlaylistSearch::addPlaylist(Playlist* p)
 {
     static_cast<QConcatenateTablesProxyModel*>(sourceModel())->addSourceModel(p->model());
     m_playlists.append(p);
+    clearMatches();
+    updateCandidates();
 }
 
 void PlaylistSearch::clearPlaylists()
 {
-    setSourceModel(new QConcatenateTablesProxyModel(this));
+    clearMatches();
+    setPlaylistsModel(new QConcatenateTablesProxyModel(this));
     m_playlists.clear();
 }
 
@@ -80,12 +88,16 @@ void PlaylistSearch::clearPlaylists()
 void PlaylistSearch::addComponent(const Component &c)
 {
     m_components.append(c);
+    clearMatches();
+    updateCandidates();
     invalidateFilter();
 }
 
 void PlaylistSearch::clearComponents()
 {
     m_components.clear();
+    clearMatches();
+    updateCandidates();
     invalidateFilter();
 }
 
@@ -94,6 +106,14 @@ PlaylistSearch::ComponentList PlaylistSearch::components() const
     return m_components;
 }
 
+void PlaylistSearch::setSearchMode(SearchMode m)
+{
+    m_mode = m;
+    clearMatches();
+    updateCandidates();
+    invalidateFilter();
+}
+
 bool PlaylistSearch::isNull() const
 {
     return m_components.isEmpty();
@@ -113,15 +133,185 @@ bool PlaylistSearch::isEmpty() const
     return true;
 }
 
+bool PlaylistSearch::refines(const PlaylistSearch &other) const
+{
+    if(other.isEmpty() || isEmpty() || m_mode != other.m_mode || m_playlists != other.m_playlists)
+        return false;
+
+    // With MatchAll every component of the other search has to be refined,
+    // extra components only narrow the search down further.  With MatchAny
+    // every component of this search has to refine one of the other's.
+
+    auto refinedBy = [](const ComponentList &components, const Component &c) {
+        return std::any_of(components.begin(), components.end(),
+                           [&c](const Component &d) { return d.refines(c); });
+    };
+    auto refinesOneOf = [](const ComponentList &components, const Component &c) {
+        return std::any_of(components.begin(), components.end(),
+                           [&c](const Component &d) { return c.refines(d); });
+    };
+
+    if(m_mode == MatchAll) {
+        return std::all_of(other.m_components.begin(), other.m_components.end(),
+                           [&](const Component &c) { return refinedBy(m_components, c); });
+    }
+
+    return std::all_of(m_components.begin(), m_components.end(),
+                       [&](const Component &c) { return refinesOneOf(other.m_components, c); });
+}
+
+void PlaylistSearch::narrowFrom(const PlaylistSearch &previous)
+{
+    CollectionList *collection = CollectionList::instance();
+    if(!collection || !refines(previous))
+        return;
+
+    const SearchIndex &index = collection->searchIndex();
+    if(m_useCandidates && m_candidatesGeneration != index.generation())
+        return;
+
+    // The previous matches are kept as index slots rather than rows, so that
+    // they stay valid when rows are added or removed.  Items that are added
+    // or refreshed from now on get new slots and are always checked.
+
+    QBitArray matched(index.slotCount());
+    for(int row = 0; row < previous.rowCount(); ++row) {
+        PlaylistItem *item = previous.itemForRow(previous.mapToSource(previous.index(row, 0)).row());
+        if(!item || !item->collectionItem())
+            return;
+        SearchIndex::addCandidate(item->collectionItem(), &matched);
+    }
+
+    if(m_useCandidates && m_candidates.size() == matched.size())
+        m_candidates &= matched;
+    else
+        m_candidates = matched;
+
+    m_useCandidates = true;
+    m_candidatesGeneration = index.generation();
+    invalidateFilter();
+}
+
 bool PlaylistSearch::filterAcceptsRow(int source_row, const QModelIndex & source_parent) const{
+    PlaylistItem *item = itemForRow(source_row);
+
+    if(m_hasMatches)
+        return m_matches.contains(item);
+
+    if(m_useCandidates && item && item->collectionItem() &&
+       m_candidatesGeneration == CollectionList::instance()->searchIndex().generation() &&
+       !SearchIndex::isCandidate(item->collectionItem(), m_candidates))
+    {
+        return false;
+    }
+
     QAbstractItemModel* const model = sourceModel();
-    auto matcher = [&](Component c){
-        return c.matches(source_row, source_parent, model);
+    auto matcher = [&](const Component &c){
+        return c.matches(source_row, source_parent, model, item);
     };
     return m_mode == MatchAny? std::any_of(m_components.begin(), m_components.end(), matcher) :
         std::all_of(m_components.begin(), m_components.end(), matcher);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// private methods
+////////////////////////////////////////////////////////////////////////////////
+
+void PlaylistSearch::updateCandidates()
+{
+    m_useCandidates = false;
+    m_candidates.clear();
+
+    CollectionList *collection = CollectionList::instance();
+    if(!collection || m_components.isEmpty())
+        return;
+
+    const SearchIndex &index = collection->searchIndex();
+    SearchCandidates candidates;
+
+    for(const auto &component : qAsConst(m_components)) {
+        QBitArray found;
+
+        if(canUseIndex(component) &&
+           (component.isPatternSearch()
+            ? index.findCandidates(component.pattern(), &found)
+            : index.findCandidates(component.query(), component.matchMode(), &found)))
+        {
+            candidates.add(found);
+        }
+        else
+            candidates.addUnindexed();
+    }
+
+    m_useCandidates = candidates.combine(m_mode, &m_candidates);
+    m_candidatesGeneration = index.generation();
+}
+
+bool PlaylistSearch::canUseIndex(const Component &component) const
+{
+    if(component.columns().isEmpty())
+        return false;
+
+    if(component.isPatternSearch() ? component.pattern().isEmpty() : component.query().isEmpty())
+        return false;
+
+    for(const Playlist *playlist : m_playlists) {
+        for(int column : component.columns()) {
+            if(!SearchIndex::isIndexedColumn(column - playlist->columnOffset()))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+PlaylistItem *PlaylistSearch::itemForRow(int sourceRow) const
+{
+    const auto model = static_cast<QConcatenateTablesProxyModel *>(sourceModel());
+    const QModelIndex index = model->mapToSource(model->index(sourceRow, 0));
+
+    for(const Playlist *playlist : m_playlists) {
+        if(playlist->model() == index.model())
+            return playlist->playlistItemFromIndex(index);
+    }
+
+    return nullptr;
+}
+
+void PlaylistSearch::setPlaylistsModel(QAbstractItemModel *model)
+{
+    // Matches found by SearchExecutor don't cover changed or new rows.  This
+    // is connected before the model is set so that they're dropped before
+    // the proxy filters those rows.
+
+    const auto clear = [this] { clearMatches(); };
+
+    connect(model, &QAbstractItemModel::dataChanged, this, clear);
+    connect(model, &QAbstractItemModel::rowsInserted, this, clear);
+    connect(model, &QAbstractItemModel::rowsRemoved, this, clear);
+    connect(model, &QAbstractItemModel::modelReset, this, clear);
+    connect(model, &QAbstractItemModel::layoutChanged, this, clear);
+
+    setSourceModel(model);
+}
+
+void PlaylistSearch::setMatches(const PlaylistItemList &items)
+{
+    m_matches.clear();
+    m_matches.reserve(items.size());
+    for(const PlaylistItem *item : items)
+        m_matches.insert(item);
+
+    m_hasMatches = true;
+    invalidateFilter();
+}
+
+void PlaylistSearch::clearMatches()
+{
+    m_hasMatches = false;
+    m_matches.clear();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Component public methods
 ////////////////////////////////////////////////////////////////////////////////
@@ -139,6 +329,7 @@ PlaylistSearch::Component::Component(const QString &query,
                                      const ColumnList &columns,
                                      MatchMode mode) :
     m_query(query),
+    m_foldedQuery(caseSensitive ? QString() : SearchKernel::fold(query)),
     m_columns(columns),
     m_mode(mode),
     m_searchAllVisible(columns.isEmpty()),
@@ -159,59 +350,90 @@ PlaylistSearch::Component::Component(const QRegExp &query, const ColumnList& col
 
 }
 
-bool PlaylistSearch::Component::matches(int row, QModelIndex parent, QAbstractItemModel* model) const
+bool PlaylistSearch::Component::matches(int row, QModelIndex parent, QAbstractItemModel* model,
+                                        const PlaylistItem *item) const
 {
-    for(int column : qAsConst(m_columns)) {
+    // Case insensitive matching compares case folded text with the query
+    // folded up front.  The items keep the folded text of most columns.
+
+    return matchesText([&](int column, bool folded) {
+        if(folded && item)
+            return item->foldedText(column);
+
         const QString str = model->index(row, column, parent).data().toString();
-        if(m_re) {
-            return str.contains(m_queryRe);
-        }
+        return folded ? SearchKernel::fold(str) : str;
+    });
+}
 
-        switch(m_mode) {
-        case Contains:
-            if(str.contains(m_query, m_caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive))
+bool PlaylistSearch::Component::matchesString(const QString &str) const
+{
+    const QString &query = m_caseSensitive ? m_query : m_foldedQuery;
+
+    switch(m_mode) {
+    case Contains:
+        if(SearchKernel::contains(str, query))
+            return true;
+        break;
+    case Exact:
+        if(str == query)
+            return true;
+        break;
+    case ContainsWord:
+    {
+        int i = SearchKernel::indexOf(str, query);
+
+        if(i >= 0) {
+
+            // If we found the pattern and the lengths are the same, then
+            // this is a match.
+
+            if(str.length() == query.length())
                 return true;
-            break;
-        case Exact:
-            // If lengths match, move on to check strings themselves
-            if(str.length() == m_query.length() &&
-               (( m_caseSensitive && str == m_query) ||
-                (!m_caseSensitive && str.toLower() == m_query.toLower()))
-               )
-            {
+
+            // First: If the match starts at the beginning of the text or the
+            // character before the match is not a word character
+
+            // AND
+
+            // Second: Either the pattern was found at the end of the text,
+            // or the text following the match is a non-word character
+
+            // ...then we have a match
+
+            if((i == 0 || !str.at(i - 1).isLetterOrNumber()) &&
+                (i + query.length() == str.length() || !str.at(i + query.length()).isLetterOrNumber()))
                 return true;
-            }
-            break;
-        case ContainsWord:
-        {
-            int i = str.indexOf(m_query, 0, m_caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
+        }
+    }
+    }
 
-            if(i >= 0) {
+    return false;
+}
 
-                // If we found the pattern and the lengths are the same, then
-                // this is a match.
+bool PlaylistSearch::Component::refines(const Component &other) const
+{
+    if(m_re || other.m_re || m_columns != other.m_columns ||
+       m_searchAllVisible != other.m_searchAllVisible)
+    {
+        return false;
+    }
 
-                if(str.length() == m_query.length())
-                    return true;
+    // A case sensitive match implies a case insensitive one, not the other
+    // way around.
 
-                // First: If the match starts at the beginning of the text or the
-                // character before the match is not a word character
+    if(other.m_caseSensitive && !m_caseSensitive)
+        return false;
 
-                // AND
+    const Qt::CaseSensitivity cs = other.m_caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
 
-                // Second: Either the pattern was found at the end of the text,
-                // or the text following the match is a non-word character
+    // Whatever this component matches contains its query.  Whole word and
+    // exact matches of a longer query aren't necessarily whole word or exact
+    // matches of a shorter one though.
 
-                // ...then we have a match
+    if(other.m_mode == Contains)
+        return m_query.contains(other.m_query, cs);
 
-                if((i == 0 || !str.at(i - 1).isLetterOrNumber()) &&
-                    (i + m_query.length() == str.length() || !str.at(i + m_query.length()).isLetterOrNumber()))
-                    return true;
-            }
-        }
-        }
-    };
-    return false;
+    return m_mode == other.m_mode && m_query.compare(other.m_query, cs) == 0;
 }
 
 bool PlaylistSearch::Component::operator==(const Component &v) const
@@ -17,7 +17,9 @@
 #ifndef PLAYLISTSEARCH_H
 #define PLAYLISTSEARCH_H
 
+#include <QBitArray>
 #include <QRegExp>
+#include <QSet>
 #include <QVector>
 #include <QSortFilterProxyModel>
 
@@ -30,6 +32,8 @@ typedef QVector<Playlist *> PlaylistList;
 
 class PlaylistSearch : QSortFilterProxyModel
 {
+    friend class SearchExecutor;
+
 public:
     class Component;
     typedef QVector<Component> ComponentList;
@@ -55,12 +59,26 @@ public:
     void clearComponents();
     ComponentList components() const;
 
-    void setSearchMode(SearchMode m) { m_mode = m; }
+    void setSearchMode(SearchMode m);
     SearchMode searchMode() const { return m_mode; }
 
     bool isNull() const;
     bool isEmpty() const;
 
+    /**
+     * Returns true if every row this search matches is also matched by
+     * \a other, e.g. when a character has been appended to the query of
+     * \a other.
+     */
+    bool refines(const PlaylistSearch &other) const;
+
+    /**
+     * If this search refines() \a previous, restricts it to the rows
+     * \a previous matched so that the other rows don't have to be checked
+     * again.
+     */
+    void narrowFrom(const PlaylistSearch &previous);
+
     bool filterAcceptsRow(int source_row, const QModelIndex& source_parent) const override;
 
     /**
@@ -71,10 +89,33 @@ public:
     void clearItem(PlaylistItem *item);
 
 private:
+    /**
+     * Narrows the rows to check down to those the collection's SearchIndex
+     * finds for the components.
+     */
+    void updateCandidates();
+    bool canUseIndex(const Component &component) const;
+    PlaylistItem *itemForRow(int sourceRow) const;
+
+    void setPlaylistsModel(QAbstractItemModel *model);
+
+    /**
+     * Makes the search match exactly \a items, which SearchExecutor found,
+     * until the searched playlists change.
+     */
+    void setMatches(const PlaylistItemList &items);
+    void clearMatches();
 
     PlaylistList m_playlists;
     ComponentList m_components;
     SearchMode m_mode;
+
+    bool m_useCandidates = false;
+    QBitArray m_candidates;
+    int m_candidatesGeneration = 0;
+
+    bool m_hasMatches = false;
+    QSet<const PlaylistItem *> m_matches;
 };
 
 /**
@@ -110,15 +151,37 @@ public:
     QRegExp pattern() const { return m_queryRe; }
     ColumnList columns() const { return m_columns; }
 
-    bool matches(int row, QModelIndex parent, QAbstractItemModel* model) const;
+    /**
+     * Returns true if the given row of \a model matches.  If \a item is the
+     * item of the row its folded text is used for case insensitive matching.
+     */
+    bool matches(int row, QModelIndex parent, QAbstractItemModel* model,
+                 const PlaylistItem *item = nullptr) const;
+
+    /**
+     * Returns true if the searched columns of a row match, where
+     * \a text(column, folded) returns the text of a column of the row, case
+     * folded or not.  This doesn't need the model, see SearchExecutor.
+     */
+    template <typename TextFunction>
+    bool matchesText(TextFunction text) const;
     bool isPatternSearch() const { return m_re; }
     bool isCaseSensitive() const { return m_caseSensitive; }
     MatchMode matchMode() const { return m_mode; }
 
+    /**
+     * Returns true if every text this component matches is also matched by
+     * \a other.
+     */
+    bool refines(const Component &other) const;
+
     bool operator==(const Component &v) const;
 
 private:
+    bool matchesString(const QString &str) const;
+
     QString m_query;
+    QString m_foldedQuery;
     QRegExp m_queryRe;
     mutable ColumnList m_columns;
     MatchMode m_mode;
@@ -127,6 +190,20 @@ private:
     bool m_re;
 };
 
+template <typename TextFunction>
+bool PlaylistSearch::Component::matchesText(TextFunction text) const
+{
+    for(int column : qAsConst(m_columns)) {
+        if(m_re)
+            return text(column, false).contains(m_queryRe);
+
+        if(matchesString(text(column, !m_caseSensitive)))
+            return true;
+    }
+
+    return false;
+}
+
 /**
  * Streams \a search to the stream \a s.
  * \note This does not save the playlist list, but instead will assume that the
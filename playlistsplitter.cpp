@@ -41,6 +41,7 @@
 #include "playermanager.h"
 #include "playlistbox.h"
 #include "playlistsearch.h"
+#include "searchexecutor.h"
 #include "searchwidget.h"
 #include "tageditor.h"
 
@@ -84,6 +85,11 @@ PlaylistSplitter::~PlaylistSplitter()
     delete m_searchWidget; // Take no chances here either.
     m_searchWidget = nullptr;
 
+    // A search still being evaluated isn't owned by any playlist yet.
+    m_searchExecutor->cancel();
+    delete m_pendingSearch;
+    m_pendingSearch = nullptr;
+
     // Since we want to ensure that the shutdown process for the PlaylistCollection
     // (a base class for PlaylistBox) has a chance to write the playlists to disk
     // before they are deleted we're explicitly deleting the PlaylistBox here.
@@ -249,8 +255,12 @@ void PlaylistSplitter::setupLayout()
     // auto-shortcuts don't seem to work and aren't needed anyway.
     KAcceleratorManager::setNoAccel(m_searchWidget);
 
+    m_searchExecutor = new SearchExecutor(this);
+
     connect(m_searchWidget,   &SearchWidget::signalQueryChanged,
             this,             &PlaylistSplitter::slotShowSearchResults);
+    connect(m_searchExecutor, &SearchExecutor::signalFinished,
+            this,             &PlaylistSplitter::slotSearchFinished);
     connect(m_searchWidget,   &SearchWidget::signalDownPressed,
             this,             &PlaylistSplitter::slotFocusCurrentPlaylist);
     connect(m_searchWidget,   &SearchWidget::signalShown,
@@ -315,7 +325,37 @@ void PlaylistSplitter::saveConfig()
 
 void PlaylistSplitter::slotShowSearchResults()
 {
-    visiblePlaylist()->setSearch(m_searchWidget->search(visiblePlaylist()));
+    // While typing only the last search is shown, the ones before it are
+    // dropped without ever being shown.
+
+    m_searchExecutor->cancel();
+    delete m_pendingSearch;
+
+    m_searchedPlaylist = visiblePlaylist();
+    m_pendingSearch = m_searchWidget->search(m_searchedPlaylist);
+
+    // Typing into the search bar usually only narrows the previous search
+    // down, so there's no need to check the rows it didn't match again.
+    // This is done before evaluating the search so that the executor only
+    // checks the rows that are left.
+
+    if(m_searchedPlaylist->search())
+        m_pendingSearch->narrowFrom(*m_searchedPlaylist->search());
+
+    m_searchExecutor->evaluate(m_pendingSearch);
+}
+
+void PlaylistSplitter::slotSearchFinished(PlaylistSearch *search)
+{
+    if(search != m_pendingSearch)
+        return;
+
+    m_pendingSearch = nullptr;
+
+    if(m_searchedPlaylist)
+        m_searchedPlaylist->setSearch(search);
+    else
+        delete search;
 }
 
 void PlaylistSplitter::slotPlaylistSelectionChanged()
@@ -17,12 +17,15 @@
 #ifndef PLAYLISTSPLITTER_H
 #define PLAYLISTSPLITTER_H
 
+#include <QPointer>
 #include <QSplitter>
 
 class QStackedWidget;
 class QTreeWidgetItem;
 
 class Playlist;
+class PlaylistSearch;
+class SearchExecutor;
 class SearchWidget;
 class PlaylistInterface;
 class TagEditor;
@@ -85,6 +88,11 @@ private slots:
      * associated with the currently visible playlist.
      */
     void slotShowSearchResults();
+
+    /**
+     * Shows the results of \a search once SearchExecutor has run it.
+     */
+    void slotSearchFinished(PlaylistSearch *search);
     void slotPlaylistSelectionChanged();
     void slotPlaylistChanged(int i);
     void slotCurrentPlaylistChanged(QTreeWidgetItem *item);
@@ -125,6 +133,10 @@ private:
     LyricsWidget   *m_lyricsWidget   = nullptr;
     Playlist       *m_newVisible     = nullptr;
     PlayerManager  *m_player         = nullptr;
+
+    SearchExecutor    *m_searchExecutor = nullptr;
+    PlaylistSearch    *m_pendingSearch  = nullptr;
+    QPointer<Playlist> m_searchedPlaylist;
 };
 
 #endif
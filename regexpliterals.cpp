@@ -0,0 +1,320 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "regexpliterals.h"
+
+#include <algorithm>
+
+// Alternatives multiply when groups with alternatives follow each other,
+// groups which would make more than this many are skipped instead.
+static const int MAX_ALTERNATIVES = 32;
+
+namespace {
+
+typedef RegExpLiterals::AlternativeList AlternativeList;
+
+// Returns the alternatives of texts matching both \a first and \a second.
+AlternativeList conjoin(const AlternativeList &first, const AlternativeList &second)
+{
+    if(first.count() * second.count() > MAX_ALTERNATIVES)
+        return first;
+
+    AlternativeList result;
+    for(const QStringList &a : first) {
+        for(const QStringList &b : second)
+            result.append(a + b);
+    }
+
+    return result;
+}
+
+void appendToAll(AlternativeList *alternatives, QString *literal)
+{
+    if(literal->isEmpty())
+        return;
+
+    for(QStringList &alternative : *alternatives)
+        alternative.append(*literal);
+
+    literal->clear();
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// public methods
+////////////////////////////////////////////////////////////////////////////////
+
+RegExpLiterals::RegExpLiterals(const QRegExp &pattern, int minLength)
+{
+    if(!pattern.isValid() || pattern.isEmpty())
+        return;
+
+    switch(pattern.patternSyntax()) {
+    case QRegExp::FixedString:
+        setAlternatives({ QStringList(pattern.pattern()) }, minLength);
+        break;
+    case QRegExp::Wildcard:
+        setAlternatives(parseWildcard(pattern.pattern(), false), minLength);
+        break;
+    case QRegExp::WildcardUnix:
+        setAlternatives(parseWildcard(pattern.pattern(), true), minLength);
+        break;
+    case QRegExp::RegExp:
+    case QRegExp::RegExp2:
+    case QRegExp::W3CXmlSchema11:
+        m_pattern = pattern.pattern();
+        m_position = 0;
+        setAlternatives(parseAlternation(), minLength);
+        break;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// private methods
+////////////////////////////////////////////////////////////////////////////////
+
+AlternativeList RegExpLiterals::parseWildcard(const QString &pattern, bool escapes) // static
+{
+    AlternativeList result(1);
+    QString literal;
+
+    for(int i = 0; i < pattern.length(); ++i) {
+        const QChar c = pattern.at(i);
+
+        if(escapes && c == QLatin1Char('\\') && i + 1 < pattern.length()) {
+            literal += pattern.at(++i);
+        }
+        else if(c == QLatin1Char('*') || c == QLatin1Char('?')) {
+            appendToAll(&result, &literal);
+        }
+        else if(c == QLatin1Char('[')) {
+            appendToAll(&result, &literal);
+            const int end = pattern.indexOf(QLatin1Char(']'), i + 2);
+            i = end < 0 ? pattern.length() : end;
+        }
+        else {
+            literal += c;
+        }
+    }
+
+    appendToAll(&result, &literal);
+    return result;
+}
+
+AlternativeList RegExpLiterals::parseAlternation()
+{
+    AlternativeList result;
+
+    forever {
+        result += parseSequence();
+
+        if(m_position < m_pattern.length() && m_pattern.at(m_position) == QLatin1Char('|')) {
+            ++m_position;
+            continue;
+        }
+
+        return result;
+    }
+}
+
+AlternativeList RegExpLiterals::parseSequence()
+{
+    AlternativeList result(1);
+    QString literal;
+    bool optional;
+    bool repeated;
+
+    while(m_position < m_pattern.length()) {
+        const QChar c = m_pattern.at(m_position);
+
+        if(c == QLatin1Char('|') || c == QLatin1Char(')'))
+            break;
+
+        ++m_position;
+
+        if(c == QLatin1Char('(')) {
+            bool lookahead = false;
+
+            if(m_pattern.midRef(m_position, 2) == QLatin1String("?:")) {
+                m_position += 2;
+            }
+            else if(m_pattern.midRef(m_position, 2) == QLatin1String("?=") ||
+                    m_pattern.midRef(m_position, 2) == QLatin1String("?!"))
+            {
+                m_position += 2;
+                lookahead = true;
+            }
+
+            const AlternativeList group = parseAlternation();
+            if(m_position < m_pattern.length())
+                ++m_position; // ')'
+
+            appendToAll(&result, &literal);
+            parseQuantifier(&optional, &repeated);
+
+            if(!lookahead && !optional)
+                result = conjoin(result, group);
+
+            continue;
+        }
+
+        if(c == QLatin1Char('[')) {
+            // Skip the class.  A ']' right after the '[' or "[^" is part of it.
+
+            if(m_position < m_pattern.length() && m_pattern.at(m_position) == QLatin1Char('^'))
+                ++m_position;
+            if(m_position < m_pattern.length() && m_pattern.at(m_position) == QLatin1Char(']'))
+                ++m_position;
+
+            while(m_position < m_pattern.length() && m_pattern.at(m_position) != QLatin1Char(']')) {
+                if(m_pattern.at(m_position) == QLatin1Char('\\'))
+                    ++m_position;
+                ++m_position;
+            }
+            ++m_position;
+
+            appendToAll(&result, &literal);
+            parseQuantifier(&optional, &repeated);
+            continue;
+        }
+
+        if(c == QLatin1Char('.') || c == QLatin1Char('^') || c == QLatin1Char('$') ||
+           c == QLatin1Char('*') || c == QLatin1Char('+') || c == QLatin1Char('?') ||
+           c == QLatin1Char('{'))
+        {
+            appendToAll(&result, &literal);
+            parseQuantifier(&optional, &repeated);
+            continue;
+        }
+
+        QChar character = c;
+        bool isLiteral = true;
+
+        if(c == QLatin1Char('\\')) {
+            if(m_position >= m_pattern.length())
+                break;
+
+            const QChar escaped = m_pattern.at(m_position++);
+
+            switch(escaped.unicode()) {
+            case 'n': character = QLatin1Char('\n'); break;
+            case 'r': character = QLatin1Char('\r'); break;
+            case 't': character = QLatin1Char('\t'); break;
+            case 'f': character = QLatin1Char('\f'); break;
+            case 'v': character = QLatin1Char('\v'); break;
+            default:
+                // Classes, assertions, back references and character codes
+                // like \x0041 aren't handled.
+                if(escaped.isLetterOrNumber()) {
+                    isLiteral = false;
+                    while(m_position < m_pattern.length() &&
+                          (escaped == QLatin1Char('x') || escaped == QLatin1Char('0')) &&
+                          m_pattern.at(m_position).isLetterOrNumber())
+                    {
+                        ++m_position;
+                    }
+                }
+                else {
+                    character = escaped;
+                }
+            }
+        }
+
+        parseQuantifier(&optional, &repeated);
+
+        if(!isLiteral || optional) {
+            appendToAll(&result, &literal);
+            continue;
+        }
+
+        literal += character;
+
+        // What comes after a repeated character isn't necessarily next to
+        // the part before it.
+
+        if(repeated)
+            appendToAll(&result, &literal);
+    }
+
+    appendToAll(&result, &literal);
+    return result;
+}
+
+void RegExpLiterals::parseQuantifier(bool *optional, bool *repeated)
+{
+    *optional = false;
+    *repeated = false;
+
+    if(m_position >= m_pattern.length())
+        return;
+
+    const QChar c = m_pattern.at(m_position);
+
+    if(c == QLatin1Char('*')) {
+        *optional = *repeated = true;
+        ++m_position;
+    }
+    else if(c == QLatin1Char('+')) {
+        *repeated = true;
+        ++m_position;
+    }
+    else if(c == QLatin1Char('?')) {
+        *optional = true;
+        ++m_position;
+    }
+    else if(c == QLatin1Char('{')) {
+        const int end = m_pattern.indexOf(QLatin1Char('}'), m_position);
+        if(end < 0)
+            return;
+
+        const QStringList bounds = m_pattern.mid(m_position + 1, end - m_position - 1)
+                                            .split(QLatin1Char(','));
+        bool ok = true;
+        const int min = bounds.first().isEmpty() ? 0 : bounds.first().toInt(&ok);
+        if(!ok || bounds.count() > 2)
+            return;
+
+        *optional = min == 0;
+        *repeated = min != 1 || (bounds.count() == 2 && bounds.last() != QLatin1String("1"));
+        m_position = end + 1;
+    }
+}
+
+void RegExpLiterals::setAlternatives(const AlternativeList &alternatives, int minLength)
+{
+    m_alternatives.clear();
+
+    for(QStringList alternative : alternatives) {
+        alternative.erase(std::remove_if(alternative.begin(), alternative.end(),
+                                         [minLength](const QString &literal) {
+                                             return literal.length() < minLength;
+                                         }),
+                          alternative.end());
+        alternative.removeDuplicates();
+
+        // Anything may match this alternative, and so the pattern.
+
+        if(alternative.isEmpty()) {
+            m_alternatives.clear();
+            return;
+        }
+
+        m_alternatives.append(alternative);
+    }
+}
+
+// vim: set et sw=4 tw=0 sta:
@@ -0,0 +1,62 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JUK_REGEXPLITERALS_H
+#define JUK_REGEXPLITERALS_H
+
+#include <QRegExp>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * The literal strings a text has to contain to match a QRegExp, which lets
+ * an index tell which texts may match before the pattern is run.
+ *
+ * A text can only match if it contains every string of one of the
+ * alternatives(), e.g. "live", "acoustic" or "demo" for "live|acoustic|demo"
+ * and both "foo" and "bar" for "foo.*bar".  Parts of the pattern which
+ * aren't literal text, like character classes and optional or repeated
+ * parts, are skipped, so a text containing the strings may still not
+ * match.  If one of the alternatives has no strings of at least the minimum
+ * length, every text may match and there are no alternatives at all.
+ */
+class RegExpLiterals
+{
+public:
+    typedef QVector<QStringList> AlternativeList;
+
+    explicit RegExpLiterals(const QRegExp &pattern, int minLength = 1);
+
+    AlternativeList alternatives() const { return m_alternatives; }
+    bool isEmpty() const { return m_alternatives.isEmpty(); }
+
+private:
+    static AlternativeList parseWildcard(const QString &pattern, bool escapes);
+
+    AlternativeList parseAlternation();
+    AlternativeList parseSequence();
+    void parseQuantifier(bool *optional, bool *repeated);
+
+    void setAlternatives(const AlternativeList &alternatives, int minLength);
+
+    QString m_pattern;
+    int m_position = 0;
+    AlternativeList m_alternatives;
+};
+
+#endif
+
+// vim: set et sw=4 tw=0 sta:
@@ -0,0 +1,52 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "searchcandidates.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// public methods
+////////////////////////////////////////////////////////////////////////////////
+
+void SearchCandidates::add(const QBitArray &candidates)
+{
+    m_indexed.append(candidates);
+}
+
+void SearchCandidates::addUnindexed()
+{
+    ++m_unindexed;
+}
+
+bool SearchCandidates::combine(PlaylistSearch::SearchMode mode, QBitArray *candidates) const
+{
+    candidates->clear();
+
+    if(m_indexed.isEmpty() || (mode == PlaylistSearch::MatchAny && m_unindexed > 0))
+        return false;
+
+    *candidates = m_indexed.first();
+
+    for(int i = 1; i < m_indexed.count(); ++i) {
+        if(mode == PlaylistSearch::MatchAll)
+            *candidates &= m_indexed[i];
+        else
+            *candidates |= m_indexed[i];
+    }
+
+    return true;
+}
+
+// vim: set et sw=4 tw=0 sta:
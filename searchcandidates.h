@@ -0,0 +1,61 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JUK_SEARCHCANDIDATES_H
+#define JUK_SEARCHCANDIDATES_H
+
+#include <QBitArray>
+#include <QVector>
+
+#include "playlistsearch.h"
+
+/**
+ * Combines the candidates the SearchIndex finds for each component of a
+ * PlaylistSearch into the candidates of the whole search.
+ *
+ * With MatchAll each component the index can narrow down narrows the search
+ * down further, and the other components are simply checked on the
+ * remaining rows.  With MatchAny a row may match any single component, so
+ * the search can only be narrowed down if the index can narrow down all of
+ * them.
+ */
+class SearchCandidates
+{
+public:
+    /**
+     * Adds the candidates of the next component.
+     */
+    void add(const QBitArray &candidates);
+
+    /**
+     * Adds a component the index can't narrow down.
+     */
+    void addUnindexed();
+
+    /**
+     * Sets \a candidates to the candidates of a search with the given
+     * \a mode.  Returns false if every row has to be checked.
+     */
+    bool combine(PlaylistSearch::SearchMode mode, QBitArray *candidates) const;
+
+private:
+    QVector<QBitArray> m_indexed;
+    int m_unindexed = 0;
+};
+
+#endif
+
+// vim: set et sw=4 tw=0 sta:
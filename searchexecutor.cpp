@@ -0,0 +1,417 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "searchexecutor.h"
+
+#include <QAbstractItemModel>
+#include <QBitArray>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <atomic>
+
+#include "collectionlist.h"
+#include "playlist.h"
+#include "playlistitem.h"
+#include "searchindex.h"
+#include "juk_debug.h"
+
+namespace {
+
+// Below this many rows to check filtering them on the GUI thread is quicker
+// than copying them out and starting the threads.
+const int MIN_PARALLEL_ROWS = 20000;
+
+// Rows per task, to have the threads check a few thousand rows at a time.
+const int MIN_ROWS_PER_TASK = 2048;
+
+} // namespace
+
+/**
+ * The text of the searched columns of each row, plain and case folded, as it
+ * was when the snapshot was taken.  Only read by the threads.
+ */
+struct SearchExecutor::Snapshot
+{
+    PlaylistList playlists;
+    QVector<int> offsets;         // By playlist, its first row
+    ColumnList columns;           // Sorted
+    QVector<int> columnPositions; // Column -> position in columns, -1 if not there
+    PlaylistItemList items;       // By row, for publishing the matches
+    QVector<QString> texts;       // By row, then column, then plain and folded
+
+    const QString &text(int row, int column, bool folded) const
+    {
+        const int position = columnPositions[column];
+        return texts[(row * columns.size() + position) * 2 + (folded ? 1 : 0)];
+    }
+
+    bool covers(const ColumnList &searched) const
+    {
+        return std::all_of(searched.begin(), searched.end(), [this](int column) {
+            return column < columnPositions.size() && columnPositions[column] >= 0;
+        });
+    }
+
+    /**
+     * Reads the text of the rows from \a first to \a last from their items.
+     */
+    void readRows(int first, int last)
+    {
+        for(int row = first; row <= last; ++row) {
+            const PlaylistItem *item = items[row];
+
+            for(int position = 0; position < columns.size(); ++position) {
+                const int i = (row * columns.size() + position) * 2;
+                texts[i] = item ? item->text(columns[position]) : QString();
+                texts[i + 1] = item ? item->foldedText(columns[position]) : QString();
+            }
+        }
+    }
+};
+
+/**
+ * What the threads need to evaluate a search, copied from the PlaylistSearch
+ * so that it can be changed or deleted on the GUI thread meanwhile.
+ */
+struct SearchExecutor::Job
+{
+    QSharedPointer<const Snapshot> snapshot;
+    PlaylistSearch::ComponentList components;
+    PlaylistSearch::SearchMode mode;
+    QBitArray candidates;         // By row, if useCandidates
+    bool useCandidates = false;
+    std::atomic<bool> cancelled { false };
+};
+
+struct SearchExecutor::EvaluateRows
+{
+    typedef QVector<int> result_type;
+
+    QSharedPointer<Job> job;
+
+    QVector<int> operator()(const RowRange &rows) const
+    {
+        const Snapshot &snapshot = *job->snapshot;
+        QVector<int> matches;
+
+        for(int row = rows.first; row < rows.second; ++row) {
+            if((row % 256) == 0 && job->cancelled.load(std::memory_order_relaxed))
+                return QVector<int>();
+
+            if(job->useCandidates && !job->candidates.testBit(row))
+                continue;
+
+            const auto text = [&snapshot, row](int column, bool folded) -> const QString & {
+                return snapshot.text(row, column, folded);
+            };
+            const auto matcher = [&text](const PlaylistSearch::Component &component) {
+                return component.matchesText(text);
+            };
+
+            const bool matched = job->mode == PlaylistSearch::MatchAny
+                ? std::any_of(job->components.begin(), job->components.end(), matcher)
+                : std::all_of(job->components.begin(), job->components.end(), matcher);
+
+            if(matched)
+                matches.append(row);
+        }
+
+        return matches;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// public methods
+////////////////////////////////////////////////////////////////////////////////
+
+SearchExecutor::SearchExecutor(QObject *parent) : QObject(parent)
+{
+    connect(&m_watcher, &QFutureWatcher<QVector<int>>::finished,
+            this, &SearchExecutor::slotJobFinished);
+}
+
+SearchExecutor::~SearchExecutor()
+{
+    cancel();
+    m_watcher.waitForFinished();
+}
+
+void SearchExecutor::evaluate(PlaylistSearch *search)
+{
+    cancel();
+
+    if(!search)
+        return;
+
+    if(!isWorthRunningInParallel(search)) {
+        emit signalFinished(search);
+        return;
+    }
+
+    ColumnList columns;
+    for(const auto &component : qAsConst(search->m_components))
+        columns += component.columns();
+    std::sort(columns.begin(), columns.end());
+    columns.erase(std::unique(columns.begin(), columns.end()), columns.end());
+
+    auto job = QSharedPointer<Job>::create();
+    job->snapshot = snapshot(search, columns);
+
+    m_snapshotReaders.erase(std::remove_if(m_snapshotReaders.begin(), m_snapshotReaders.end(),
+                                           [](const QWeakPointer<Job> &job) { return job.isNull(); }),
+                            m_snapshotReaders.end());
+    m_snapshotReaders.append(job);
+    job->components = search->m_components;
+    job->mode = search->m_mode;
+
+    const Snapshot &snapshot = *job->snapshot;
+    const int rows = snapshot.items.size();
+
+    // The index slots of the items are only valid on the GUI thread, so look
+    // up which rows are candidates here.
+
+    if(search->m_useCandidates &&
+       search->m_candidatesGeneration == CollectionList::instance()->searchIndex().generation())
+    {
+        job->useCandidates = true;
+        job->candidates = QBitArray(rows);
+
+        for(int row = 0; row < rows; ++row) {
+            PlaylistItem *item = snapshot.items[row];
+            if(!item || !item->collectionItem() ||
+               SearchIndex::isCandidate(item->collectionItem(), search->m_candidates))
+            {
+                job->candidates.setBit(row);
+            }
+        }
+    }
+
+    const int rowsPerTask = qMax(MIN_ROWS_PER_TASK, rows / (QThread::idealThreadCount() * 4));
+
+    QVector<RowRange> ranges;
+    for(int first = 0; first < rows; first += rowsPerTask)
+        ranges.append(RowRange(first, qMin(rows, first + rowsPerTask)));
+
+    m_job = job;
+    m_search = static_cast<QObject *>(search);
+    m_watcher.setFuture(QtConcurrent::mapped(ranges, EvaluateRows { job }));
+}
+
+void SearchExecutor::cancel()
+{
+    if(m_job) {
+        m_job->cancelled = true;
+        m_job.reset();
+    }
+
+    m_watcher.cancel();
+    m_search.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// private methods
+////////////////////////////////////////////////////////////////////////////////
+
+bool SearchExecutor::isWorthRunningInParallel(const PlaylistSearch *search) const
+{
+    if(search->m_hasMatches || search->isEmpty() || !search->sourceModel())
+        return false;
+
+    int rows = search->sourceModel()->rowCount();
+
+    if(search->m_useCandidates)
+        rows = qMin(rows, int(search->m_candidates.count(true)));
+
+    return rows >= MIN_PARALLEL_ROWS;
+}
+
+QSharedPointer<const SearchExecutor::Snapshot>
+SearchExecutor::snapshot(PlaylistSearch *search, const ColumnList &columns)
+{
+    if(m_snapshot && m_snapshot->playlists == search->m_playlists && m_snapshot->covers(columns))
+        return m_snapshot;
+
+    invalidateSnapshot();
+
+    auto snapshot = QSharedPointer<Snapshot>::create();
+    snapshot->playlists = search->m_playlists;
+    snapshot->columns = columns;
+    snapshot->columnPositions.fill(-1, columns.isEmpty() ? 0 : columns.last() + 1);
+    for(int i = 0; i < columns.size(); ++i)
+        snapshot->columnPositions[columns[i]] = i;
+
+    // The text is read from the items rather than through the model, which
+    // is a lot slower for the large playlists this is used for.
+
+    for(Playlist *playlist : qAsConst(search->m_playlists)) {
+        snapshot->offsets.append(snapshot->items.size());
+        for(int row = 0; row < playlist->topLevelItemCount(); ++row)
+            snapshot->items.append(static_cast<PlaylistItem *>(playlist->topLevelItem(row)));
+    }
+
+    const int rows = snapshot->items.size();
+    snapshot->texts.resize(rows * columns.size() * 2);
+    snapshot->readRows(0, rows - 1);
+
+    // Changed, added and removed rows are updated in place, other changes
+    // make the snapshot useless.  Matches found in a snapshot that changed
+    // meanwhile are dropped in slotJobFinished().
+
+    for(int i = 0; i < search->m_playlists.size(); ++i) {
+        const QAbstractItemModel *playlistModel = search->m_playlists[i]->model();
+        const auto invalidate = [this] { invalidateSnapshot(); };
+
+        m_snapshotConnections
+            << connect(playlistModel, &QAbstractItemModel::dataChanged, this,
+                       [this, i](const QModelIndex &topLeft, const QModelIndex &bottomRight,
+                                 const QVector<int> &roles)
+                       {
+                           updateRows(i, topLeft, bottomRight, roles);
+                       })
+            << connect(playlistModel, &QAbstractItemModel::rowsInserted, this,
+                       [this, i](const QModelIndex &parent, int first, int last) {
+                           insertRows(i, parent, first, last);
+                       })
+            << connect(playlistModel, &QAbstractItemModel::rowsAboutToBeRemoved, this,
+                       [this, i](const QModelIndex &parent, int first, int last) {
+                           removeRows(i, parent, first, last);
+                       })
+            << connect(playlistModel, &QAbstractItemModel::rowsAboutToBeMoved, this, invalidate)
+            << connect(playlistModel, &QAbstractItemModel::modelAboutToBeReset, this, invalidate)
+            << connect(playlistModel, &QAbstractItemModel::layoutAboutToBeChanged, this, invalidate)
+            << connect(playlistModel, &QObject::destroyed, this, invalidate);
+    }
+
+    m_snapshot = snapshot;
+    return m_snapshot;
+}
+
+SearchExecutor::Snapshot *SearchExecutor::detachSnapshot()
+{
+    // Jobs that are still being evaluated read the snapshot, so it's copied
+    // before it's changed while they are.  Cancelled jobs keep reading until
+    // their threads notice, but they're gone once the jobs are deleted.
+
+    const bool shared = std::any_of(m_snapshotReaders.cbegin(), m_snapshotReaders.cend(),
+                                    [](const QWeakPointer<Job> &job) { return !job.isNull(); });
+    m_snapshotReaders.clear();
+
+    if(shared)
+        m_snapshot = QSharedPointer<Snapshot>::create(*m_snapshot);
+
+    return m_snapshot.data();
+}
+
+void SearchExecutor::invalidateSnapshot()
+{
+    for(const auto &connection : qAsConst(m_snapshotConnections))
+        disconnect(connection);
+
+    m_snapshotConnections.clear();
+    m_snapshot.reset();
+    m_snapshotReaders.clear();
+}
+
+void SearchExecutor::updateRows(int playlist, const QModelIndex &topLeft,
+                                const QModelIndex &bottomRight, const QVector<int> &roles)
+{
+    if(topLeft.parent().isValid())
+        return;
+
+    if(!roles.isEmpty() && !roles.contains(Qt::DisplayRole))
+        return;
+
+    Snapshot *snapshot = detachSnapshot();
+    const int offset = snapshot->offsets[playlist];
+    snapshot->readRows(offset + topLeft.row(), offset + bottomRight.row());
+}
+
+void SearchExecutor::insertRows(int playlist, const QModelIndex &parent, int first, int last)
+{
+    if(parent.isValid())
+        return;
+
+    Snapshot *snapshot = detachSnapshot();
+    const Playlist *p = snapshot->playlists[playlist];
+    const int row = snapshot->offsets[playlist] + first;
+    const int count = last - first + 1;
+    const int columns = snapshot->columns.size();
+
+    snapshot->items.insert(row, count, nullptr);
+    snapshot->texts.insert(row * columns * 2, count * columns * 2, QString());
+
+    for(int i = 0; i < count; ++i)
+        snapshot->items[row + i] = static_cast<PlaylistItem *>(p->topLevelItem(first + i));
+    snapshot->readRows(row, row + count - 1);
+
+    for(int i = playlist + 1; i < snapshot->offsets.size(); ++i)
+        snapshot->offsets[i] += count;
+}
+
+void SearchExecutor::removeRows(int playlist, const QModelIndex &parent, int first, int last)
+{
+    if(parent.isValid())
+        return;
+
+    Snapshot *snapshot = detachSnapshot();
+    const int row = snapshot->offsets[playlist] + first;
+    const int count = last - first + 1;
+    const int columns = snapshot->columns.size();
+
+    snapshot->items.remove(row, count);
+    snapshot->texts.remove(row * columns * 2, count * columns * 2);
+
+    for(int i = playlist + 1; i < snapshot->offsets.size(); ++i)
+        snapshot->offsets[i] -= count;
+}
+
+void SearchExecutor::slotJobFinished()
+{
+    if(!m_job || !m_watcher.isFinished() || m_watcher.isCanceled())
+        return;
+
+    const QSharedPointer<Job> job = m_job;
+    m_job.reset();
+
+    PlaylistSearch *search = static_cast<PlaylistSearch *>(m_search.data());
+    m_search.clear();
+
+    if(!search)
+        return;
+
+    // If the playlists or the search changed while it was evaluated, the
+    // matches may be wrong, and the search filters the rows itself.
+
+    if(job->snapshot != m_snapshot || job->components != search->m_components) {
+        qCDebug(JUK_LOG) << "Search results are out of date, filtering again";
+        emit signalFinished(search);
+        return;
+    }
+
+    PlaylistItemList items;
+    const auto results = m_watcher.future().results();
+    for(const QVector<int> &rows : results) {
+        for(int row : rows)
+            items.append(job->snapshot->items[row]);
+    }
+
+    search->setMatches(items);
+    emit signalFinished(search);
+}
+
+// vim: set et sw=4 tw=0 sta:
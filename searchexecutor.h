@@ -0,0 +1,102 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JUK_SEARCHEXECUTOR_H
+#define JUK_SEARCHEXECUTOR_H
+
+#include <QFutureWatcher>
+#include <QMetaObject>
+#include <QObject>
+#include <QPair>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QWeakPointer>
+#include <QVector>
+
+#include "playlistsearch.h"
+
+/**
+ * Evaluates PlaylistSearches over large playlists on QtConcurrent's thread
+ * pool instead of filtering them row by row on the GUI thread.
+ *
+ * The text of the searched columns is copied into a read-only snapshot
+ * first, which is reused by the following searches and kept up to date as
+ * rows are changed, added and removed, and the rows are split up between the
+ * threads.
+ * Evaluating a search cancels the one still being evaluated, so that only
+ * the matches of the last of a series of searches, e.g. while typing, are
+ * handed to the search.  signalFinished() is emitted once they are.
+ *
+ * Small playlists, and searches the SearchIndex narrows down to a few rows,
+ * are cheaper to filter right away and finish before evaluate() returns.
+ */
+class SearchExecutor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SearchExecutor(QObject *parent = nullptr);
+    virtual ~SearchExecutor();
+
+    /**
+     * Starts evaluating \a search, cancelling the search being evaluated.
+     */
+    void evaluate(PlaylistSearch *search);
+
+    /**
+     * Cancels the search being evaluated.  signalFinished() won't be
+     * emitted for it.
+     */
+    void cancel();
+
+    bool isRunning() const { return !m_job.isNull(); }
+
+signals:
+    /**
+     * Emitted once \a search has its matches, see PlaylistSearch::matchedItems().
+     */
+    void signalFinished(PlaylistSearch *search);
+
+private:
+    struct Snapshot;
+    struct Job;
+    struct EvaluateRows;
+    typedef QPair<int, int> RowRange;
+
+    bool isWorthRunningInParallel(const PlaylistSearch *search) const;
+    QSharedPointer<const Snapshot> snapshot(PlaylistSearch *search, const ColumnList &columns);
+    Snapshot *detachSnapshot();
+    void invalidateSnapshot();
+
+    void updateRows(int playlist, const QModelIndex &topLeft, const QModelIndex &bottomRight,
+                    const QVector<int> &roles);
+    void insertRows(int playlist, const QModelIndex &parent, int first, int last);
+    void removeRows(int playlist, const QModelIndex &parent, int first, int last);
+
+    void slotJobFinished();
+
+    QSharedPointer<Snapshot> m_snapshot;
+    QVector<QWeakPointer<Job>> m_snapshotReaders; // Jobs given m_snapshot
+    QVector<QMetaObject::Connection> m_snapshotConnections;
+
+    QSharedPointer<Job> m_job;
+    QPointer<QObject> m_search;
+    QFutureWatcher<QVector<int>> m_watcher;
+};
+
+#endif
+
+// vim: set et sw=4 tw=0 sta:
@@ -0,0 +1,402 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "searchindex.h"
+
+#include <QElapsedTimer>
+
+#include <algorithm>
+
+#include "collectionlist.h"
+#include "playlistitem.h"
+#include "regexpliterals.h"
+#include "searchkernel.h"
+#include "juk_debug.h"
+
+// Removed items' slots are reclaimed once there are at least this many and
+// they are the majority.
+static const int MIN_REMOVED_SLOTS = 4096;
+
+// Pattern literals shorter than this have no trigrams to look up.
+static const int TRIGRAM_LENGTH = 3;
+
+namespace {
+
+struct Word
+{
+    int start;
+    int length;
+};
+
+// Splits text at everything which isn't a letter or a digit, the same way
+// that PlaylistSearch tells where a word starts and ends.
+QVector<Word> words(const QString &text)
+{
+    QVector<Word> result;
+    const int length = text.length();
+
+    for(int i = 0; i < length; ) {
+        if(!text.at(i).isLetterOrNumber()) {
+            ++i;
+            continue;
+        }
+
+        const int start = i;
+        while(i < length && text.at(i).isLetterOrNumber())
+            ++i;
+
+        result.append({ start, i - start });
+    }
+
+    return result;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// public methods
+////////////////////////////////////////////////////////////////////////////////
+
+SearchIndex::SearchIndex()
+{
+}
+
+void SearchIndex::build(const QVector<CollectionListItem *> &items)
+{
+    QElapsedTimer stopwatch;
+    stopwatch.start();
+
+    m_built = true;
+    m_items.reserve(items.count());
+
+    for(CollectionListItem *item : items)
+        insert(item);
+
+    qCDebug(JUK_LOG) << "Indexed" << m_tokens.count() << "words of" << items.count()
+                     << "tracks for searching in" << stopwatch.elapsed() << "ms";
+}
+
+void SearchIndex::insert(CollectionListItem *item)
+{
+    if(!m_built)
+        return;
+
+    removeSlot(item);
+
+    const int slot = m_items.count();
+    m_items.append(item);
+    item->m_searchSlot = slot;
+
+    const QStringList texts = indexedTexts(item);
+    QVector<int> tokens;
+
+    for(const QString &text : texts) {
+        for(const auto &word : words(text))
+            tokens.append(tokenId(SearchKernel::fold(text.mid(word.start, word.length))));
+    }
+
+    std::sort(tokens.begin(), tokens.end());
+    tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+
+    for(int token : qAsConst(tokens))
+        m_postings[token].append(slot);
+
+    if(m_trigramsBuilt)
+        insertTrigrams(slot, texts);
+
+    compactIfNeeded();
+}
+
+void SearchIndex::remove(CollectionListItem *item)
+{
+    removeSlot(item);
+    compactIfNeeded();
+}
+
+bool SearchIndex::isIndexedColumn(int column) // static
+{
+    switch(column) {
+    case PlaylistItem::TrackColumn:
+    case PlaylistItem::ArtistColumn:
+    case PlaylistItem::AlbumColumn:
+    case PlaylistItem::TrackNumberColumn:
+    case PlaylistItem::GenreColumn:
+    case PlaylistItem::YearColumn:
+    case PlaylistItem::LengthColumn:
+    case PlaylistItem::BitrateColumn:
+    case PlaylistItem::FileNameColumn:
+    case PlaylistItem::FullPathColumn:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool SearchIndex::findCandidates(const QString &query, PlaylistSearch::Component::MatchMode mode,
+                                 QBitArray *candidates) const
+{
+    if(!m_built)
+        return false;
+
+    const QVector<Word> queryWords = words(query);
+    if(queryWords.isEmpty())
+        return false;
+
+    // Every word of the query is found within a word of a matching text.
+    // Only the first and last words of a Contains query may be part of a
+    // longer word, the others have to be the same.
+
+    *candidates = QBitArray(m_items.count(), true);
+
+    for(const auto &word : queryWords) {
+        const QString token = SearchKernel::fold(query.mid(word.start, word.length));
+        const bool openStart = mode == PlaylistSearch::Component::Contains && word.start == 0;
+        const bool openEnd = mode == PlaylistSearch::Component::Contains &&
+            word.start + word.length == query.length();
+
+        QBitArray matches(m_items.count());
+
+        if(!openStart && !openEnd) {
+            const int id = m_tokenIds.value(token, -1);
+            if(id >= 0) {
+                for(int slot : m_postings[id])
+                    matches.setBit(slot);
+            }
+        }
+        else {
+            for(int id = 0; id < m_tokens.count(); ++id) {
+                const QString &candidate = m_tokens[id];
+                const bool found = openStart && openEnd ? candidate.contains(token) :
+                                   openStart ? candidate.endsWith(token) :
+                                   candidate.startsWith(token);
+                if(!found)
+                    continue;
+
+                for(int slot : m_postings[id])
+                    matches.setBit(slot);
+            }
+        }
+
+        *candidates &= matches;
+    }
+
+    return true;
+}
+
+bool SearchIndex::findCandidates(const QRegExp &pattern, QBitArray *candidates) const
+{
+    if(!m_built)
+        return false;
+
+    const RegExpLiterals literals(pattern, TRIGRAM_LENGTH);
+    if(literals.isEmpty())
+        return false;
+
+    if(!m_trigramsBuilt)
+        buildTrigrams();
+
+    // A matching text contains all the trigrams of the literals of one of
+    // the alternatives.
+
+    *candidates = QBitArray(m_items.count());
+
+    const auto alternatives = literals.alternatives();
+    for(const QStringList &alternative : alternatives) {
+        QBitArray matches(m_items.count(), true);
+
+        for(const QString &literal : alternative) {
+            const auto literalTrigrams = trigrams(SearchKernel::fold(literal));
+            for(Trigram trigram : literalTrigrams) {
+                QBitArray found(m_items.count());
+                for(int slot : m_trigrams.value(trigram))
+                    found.setBit(slot);
+
+                matches &= found;
+            }
+        }
+
+        *candidates |= matches;
+    }
+
+    return true;
+}
+
+bool SearchIndex::isCandidate(const CollectionListItem *item, const QBitArray &candidates) // static
+{
+    const int slot = item->m_searchSlot;
+    return slot < 0 || slot >= candidates.size() || candidates.testBit(slot);
+}
+
+void SearchIndex::addCandidate(const CollectionListItem *item, QBitArray *candidates) // static
+{
+    const int slot = item->m_searchSlot;
+    if(slot >= 0 && slot < candidates->size())
+        candidates->setBit(slot);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// private methods
+////////////////////////////////////////////////////////////////////////////////
+
+QStringList SearchIndex::indexedTexts(CollectionListItem *item) // static
+{
+    const int offset = CollectionList::instance()->columnOffset();
+    QStringList texts;
+
+    for(int column = 0; column <= PlaylistItem::lastColumn(); ++column) {
+        if(isIndexedColumn(column))
+            texts.append(item->text(column + offset));
+    }
+
+    return texts;
+}
+
+QVector<SearchIndex::Trigram> SearchIndex::trigrams(const QString &foldedText) // static
+{
+    QVector<Trigram> result;
+    const ushort *text = foldedText.utf16();
+
+    for(int i = 0; i + TRIGRAM_LENGTH <= foldedText.length(); ++i)
+        result.append(Trigram(text[i]) << 32 | Trigram(text[i + 1]) << 16 | text[i + 2]);
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+
+    return result;
+}
+
+void SearchIndex::buildTrigrams() const
+{
+    QElapsedTimer stopwatch;
+    stopwatch.start();
+
+    m_trigramsBuilt = true;
+
+    for(int slot = 0; slot < m_items.count(); ++slot) {
+        if(m_items[slot])
+            insertTrigrams(slot, indexedTexts(m_items[slot]));
+    }
+
+    qCDebug(JUK_LOG) << "Indexed" << m_trigrams.count() << "trigrams for pattern searches in"
+                     << stopwatch.elapsed() << "ms";
+}
+
+void SearchIndex::insertTrigrams(int slot, const QStringList &texts) const
+{
+    QVector<Trigram> itemTrigrams;
+    for(const QString &text : texts)
+        itemTrigrams += trigrams(SearchKernel::fold(text));
+
+    std::sort(itemTrigrams.begin(), itemTrigrams.end());
+    itemTrigrams.erase(std::unique(itemTrigrams.begin(), itemTrigrams.end()), itemTrigrams.end());
+
+    for(Trigram trigram : qAsConst(itemTrigrams))
+        m_trigrams[trigram].append(slot);
+}
+
+int SearchIndex::tokenId(const QString &token)
+{
+    auto it = m_tokenIds.constFind(token);
+    if(it != m_tokenIds.constEnd())
+        return *it;
+
+    const int id = m_tokens.count();
+    m_tokenIds.insert(token, id);
+    m_tokens.append(token);
+    m_postings.append(QVector<int>());
+
+    return id;
+}
+
+void SearchIndex::removeSlot(CollectionListItem *item)
+{
+    const int slot = item->m_searchSlot;
+    if(slot < 0 || slot >= m_items.count() || m_items[slot] != item)
+        return;
+
+    m_items[slot] = nullptr;
+    item->m_searchSlot = -1;
+    ++m_removed;
+}
+
+void SearchIndex::compactIfNeeded()
+{
+    if(m_removed >= MIN_REMOVED_SLOTS && m_removed * 2 > m_items.count())
+        compact();
+}
+
+void SearchIndex::compact()
+{
+    QVector<int> newSlots(m_items.count(), -1);
+    QVector<CollectionListItem *> items;
+    items.reserve(m_items.count() - m_removed);
+
+    for(int slot = 0; slot < m_items.count(); ++slot) {
+        CollectionListItem *item = m_items[slot];
+        if(!item)
+            continue;
+
+        newSlots[slot] = items.count();
+        item->m_searchSlot = items.count();
+        items.append(item);
+    }
+
+    // Words only removed items had are dropped.
+
+    QHash<QString, int> tokenIds;
+    QVector<QString> tokens;
+    QVector<QVector<int>> postings;
+
+    for(int id = 0; id < m_tokens.count(); ++id) {
+        QVector<int> posting;
+        for(int slot : qAsConst(m_postings[id])) {
+            if(newSlots[slot] >= 0)
+                posting.append(newSlots[slot]);
+        }
+
+        if(posting.isEmpty())
+            continue;
+
+        tokenIds.insert(m_tokens[id], tokens.count());
+        tokens.append(m_tokens[id]);
+        postings.append(posting);
+    }
+
+    for(auto it = m_trigrams.begin(); it != m_trigrams.end(); ) {
+        QVector<int> posting;
+        for(int slot : qAsConst(*it)) {
+            if(newSlots[slot] >= 0)
+                posting.append(newSlots[slot]);
+        }
+
+        if(posting.isEmpty()) {
+            it = m_trigrams.erase(it);
+        }
+        else {
+            *it = posting;
+            ++it;
+        }
+    }
+
+    m_items = items;
+    m_tokenIds = tokenIds;
+    m_tokens = tokens;
+    m_postings = postings;
+    m_removed = 0;
+    ++m_generation;
+}
+
+// vim: set et sw=4 tw=0 sta:
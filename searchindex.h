@@ -0,0 +1,141 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JUK_SEARCHINDEX_H
+#define JUK_SEARCHINDEX_H
+
+#include <QBitArray>
+#include <QHash>
+#include <QRegExp>
+#include <QStringList>
+#include <QString>
+#include <QVector>
+
+#include "playlistsearch.h"
+
+class CollectionListItem;
+
+/**
+ * An inverted index from the words in the tags of the collection's tracks to
+ * the tracks, which PlaylistSearch uses to find the few rows a query can
+ * match instead of checking every row.  The CollectionList keeps it up to
+ * date as items are added, refreshed and removed, once it has been built.
+ *
+ * Words are runs of letters and digits, compared case folded.  Each indexed
+ * item has a slot, and the candidates for a query are a bit array over the
+ * slots.  A refreshed item moves to a new slot so that bit arrays taken
+ * before treat it as a candidate.  Slots of removed items are reclaimed
+ * every once in a while, which changes generation().
+ *
+ * Pattern searches are narrowed down with the trigrams, the runs of three
+ * characters, of the case folded text, which are only indexed once the
+ * first pattern search needs them.
+ *
+ * Comments are not indexed, as they are only decoded from the cache when
+ * they're shown.
+ */
+class SearchIndex
+{
+public:
+    SearchIndex();
+
+    bool isBuilt() const { return m_built; }
+
+    /**
+     * Indexes \a items and keeps the index up to date from then on.
+     */
+    void build(const QVector<CollectionListItem *> &items);
+
+    /**
+     * Indexes \a item again after its tags changed.  Does nothing before the
+     * index is built.
+     */
+    void insert(CollectionListItem *item);
+    void remove(CollectionListItem *item);
+
+    /**
+     * Returns true if the text of \a column, one of PlaylistItem::ColumnType,
+     * is indexed.
+     */
+    static bool isIndexedColumn(int column);
+
+    /**
+     * Sets the bits of \a candidates for the slots of the items which may
+     * contain \a query in one of their indexed columns with the given
+     * \a mode.  Returns false if the index can't tell, in which case every
+     * item may match.
+     */
+    bool findCandidates(const QString &query, PlaylistSearch::Component::MatchMode mode,
+                        QBitArray *candidates) const;
+
+    /**
+     * The same for the items which may match \a pattern, by the trigrams of
+     * the literal text it requires (see RegExpLiterals).  Returns false for
+     * patterns without literal text of at least three characters.
+     */
+    bool findCandidates(const QRegExp &pattern, QBitArray *candidates) const;
+
+    /**
+     * Returns true if \a item may match according to \a candidates.  Items
+     * indexed after \a candidates was found always may.
+     */
+    static bool isCandidate(const CollectionListItem *item, const QBitArray &candidates);
+
+    /**
+     * Marks \a item as a candidate in \a candidates, which has slotCount()
+     * bits.
+     */
+    static void addCandidate(const CollectionListItem *item, QBitArray *candidates);
+
+    int slotCount() const { return m_items.count(); }
+
+    /**
+     * Changes when slots are reclaimed, which makes earlier candidates
+     * invalid.
+     */
+    int generation() const { return m_generation; }
+
+private:
+    typedef quint64 Trigram;
+
+    static QStringList indexedTexts(CollectionListItem *item);
+    static QVector<Trigram> trigrams(const QString &foldedText);
+
+    void buildTrigrams() const;
+    void insertTrigrams(int slot, const QStringList &texts) const;
+
+    int tokenId(const QString &token);
+    void removeSlot(CollectionListItem *item);
+    void compactIfNeeded();
+    void compact();
+
+    QHash<QString, int> m_tokenIds;
+    QVector<QString> m_tokens;
+    QVector<QVector<int>> m_postings;     // Token -> slots, ascending
+    QVector<CollectionListItem *> m_items; // Slot -> item, null once removed
+    int m_removed = 0;
+    int m_generation = 0;
+    bool m_built = false;
+
+    // Trigram -> slots, ascending.  These are several times the size of the
+    // words, and are built the first time a pattern search asks for them.
+    mutable QHash<Trigram, QVector<int>> m_trigrams;
+    mutable bool m_trigramsBuilt = false;
+};
+
+#endif
+
+// vim: set et sw=4 tw=0 sta:
@@ -0,0 +1,94 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "searchkernel.h"
+
+#include <QtGlobal>
+
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Whether the characters between the first and the last one match, which
+// have already been compared.
+inline bool innerMatches(const ushort *haystack, const ushort *needle, int last)
+{
+    return last < 2 || std::equal(needle + 1, needle + last, haystack + 1);
+}
+
+} // namespace
+
+QString SearchKernel::fold(const QString &text)
+{
+    return text.toCaseFolded();
+}
+
+int SearchKernel::indexOf(const QChar *haystack, int haystackLength,
+                          const QChar *needle, int needleLength)
+{
+    if(needleLength <= 0)
+        return 0;
+    if(needleLength > haystackLength)
+        return -1;
+
+    const ushort *h = reinterpret_cast<const ushort *>(haystack);
+    const ushort *n = reinterpret_cast<const ushort *>(needle);
+    const int last = needleLength - 1;
+    const int end = haystackLength - needleLength;   // The last possible match
+    int i = 0;
+
+#ifdef __SSE2__
+    // Compares the first and the last character of the needle at eight
+    // positions at once, and only the positions where both match are
+    // compared in full.  Matches in text are rare, so that's hardly ever.
+
+    const __m128i first = _mm_set1_epi16(short(n[0]));
+    const __m128i lastChar = _mm_set1_epi16(short(n[last]));
+
+    for(; i + 7 <= end; i += 8) {
+        const __m128i firstBlock = _mm_loadu_si128(reinterpret_cast<const __m128i *>(h + i));
+        const __m128i lastBlock = _mm_loadu_si128(reinterpret_cast<const __m128i *>(h + i + last));
+        const __m128i found = _mm_and_si128(_mm_cmpeq_epi16(firstBlock, first),
+                                            _mm_cmpeq_epi16(lastBlock, lastChar));
+
+        // Two bits per character.
+        uint mask = uint(_mm_movemask_epi8(found));
+
+        while(mask) {
+            const int bit = qCountTrailingZeroBits(mask);
+            const int position = i + bit / 2;
+
+            if(innerMatches(h + position, n, last))
+                return position;
+
+            mask &= ~(3u << bit);
+        }
+    }
+#endif
+
+    for(; i <= end; ++i) {
+        if(h[i] == n[0] && h[i + last] == n[last] && innerMatches(h + i, n, last))
+            return i;
+    }
+
+    return -1;
+}
+
+// vim: set et sw=4 tw=0 sta:
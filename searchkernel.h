@@ -0,0 +1,57 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JUK_SEARCHKERNEL_H
+#define JUK_SEARCHKERNEL_H
+
+#include <QString>
+
+/**
+ * The string matching PlaylistSearch does for each row.  Case insensitive
+ * searches compare case folded text, which the items keep for each column
+ * (see PlaylistItem::foldedText()), against a query folded once up front
+ * instead of folding both for every comparison.
+ */
+namespace SearchKernel
+{
+    /**
+     * Returns \a text case folded the way the items' text is stored.
+     */
+    QString fold(const QString &text);
+
+    /**
+     * Returns the position of the first occurrence of \a needle in
+     * \a haystack, comparing exactly, or -1 if there is none.  Uses SSE2
+     * where available.
+     */
+    int indexOf(const QChar *haystack, int haystackLength,
+                const QChar *needle, int needleLength);
+
+    inline int indexOf(const QString &haystack, const QString &needle)
+    {
+        return indexOf(haystack.constData(), haystack.length(),
+                       needle.constData(), needle.length());
+    }
+
+    inline bool contains(const QString &haystack, const QString &needle)
+    {
+        return indexOf(haystack, needle) >= 0;
+    }
+}
+
+#endif
+
+// vim: set et sw=4 tw=0 sta:
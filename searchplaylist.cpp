@@ -19,6 +19,7 @@
 
 #include "playlistitem.h"
 #include "collectionlist.h"
+#include "searchexecutor.h"
 #include "juk_debug.h"
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -32,15 +33,18 @@ SearchPlaylist::SearchPlaylist(PlaylistCollection *collection,
                                bool synchronizePlaying) :
     DynamicPlaylist(search.playlists(), collection, name, "edit-find",
                     setupPlaylist, synchronizePlaying),
-    m_search(&search)
+    m_search(&search),
+    m_executor(new SearchExecutor(this))
 {
-
+    connect(m_executor, &SearchExecutor::signalFinished,
+            this, &SearchPlaylist::slotSearchFinished);
 }
 
 SearchPlaylist::~SearchPlaylist()
 {
     // DynamicPlaylist needs us to call this while the virtual call still works
-    updateItems();
+    m_executor->cancel();
+    synchronizeToSearch();
 }
 
 void SearchPlaylist::setPlaylistSearch(PlaylistSearch* s, bool update)
@@ -55,6 +59,25 @@ void SearchPlaylist::setPlaylistSearch(PlaylistSearch* s, bool update)
 ////////////////////////////////////////////////////////////////////////////////
 
 void SearchPlaylist::updateItems()
+{
+    m_executor->evaluate(m_search);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// private slots
+////////////////////////////////////////////////////////////////////////////////
+
+void SearchPlaylist::slotSearchFinished(PlaylistSearch *search)
+{
+    if(search == m_search)
+        synchronizeToSearch();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// private methods
+////////////////////////////////////////////////////////////////////////////////
+
+void SearchPlaylist::synchronizeToSearch()
 {
     // Here we don't simply use "clear" since that would involve a call to
     // items() which would in turn call this method...
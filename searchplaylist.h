@@ -19,6 +19,8 @@
 
 #include "dynamicplaylist.h"
 
+class SearchExecutor;
+
 class SearchPlaylist : public DynamicPlaylist
 {
     Q_OBJECT
@@ -37,12 +39,22 @@ public:
 
 protected:
     /**
-     * Runs the search to update the current items.
+     * Starts running the search to update the current items, which happens
+     * once it's done.  See SearchExecutor.
      */
     virtual void updateItems() override;
 
+private slots:
+    void slotSearchFinished(PlaylistSearch *search);
+
 private:
+    /**
+     * Makes the items those the search matches.
+     */
+    void synchronizeToSearch();
+
     PlaylistSearch* m_search;
+    SearchExecutor* m_executor;
 };
 
 QDataStream &operator<<(QDataStream &s, const SearchPlaylist &p);
@@ -0,0 +1,196 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "startuptimeline.h"
+
+#include <QEvent>
+#include <QMutexLocker>
+#include <QWidget>
+
+#include <cstdio>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#include "juk_debug.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// public methods
+////////////////////////////////////////////////////////////////////////////////
+
+StartupTimeline *StartupTimeline::instance()
+{
+    static StartupTimeline timeline;
+    return &timeline;
+}
+
+void StartupTimeline::begin(Phase phase)
+{
+    const Usage usage = currentUsage();
+
+    QMutexLocker locker(&m_lock);
+    PhaseRecord &record = m_phases[phase];
+
+    if(record.started >= 0)
+        return;
+
+    record.started = m_clock.elapsed();
+    record.cpuAtStart = usage.cpuMsecs;
+}
+
+void StartupTimeline::end(Phase phase, int items)
+{
+    const Usage usage = currentUsage();
+
+    QMutexLocker locker(&m_lock);
+    PhaseRecord &record = m_phases[phase];
+
+    if(record.started < 0 || record.finished >= 0)
+        return;
+
+    record.finished = m_clock.elapsed();
+    record.cpuMsecs = usage.cpuMsecs - record.cpuAtStart;
+    record.peakRssKiB = usage.peakRssKiB;
+    record.items += items;
+
+    qCDebug(JUK_LOG) << "Startup phase" << phaseName(phase) << "took"
+                     << record.finished - record.started << "ms for" << record.items << "items";
+
+    locker.unlock();
+
+    if(phase == FolderScan && m_printWhenFinished)
+        std::fputs(qPrintable(report()), stderr);
+}
+
+void StartupTimeline::addItems(Phase phase, int items)
+{
+    QMutexLocker locker(&m_lock);
+
+    if(m_phases[phase].finished < 0)
+        m_phases[phase].items += items;
+}
+
+void StartupTimeline::watchFirstPaint(QWidget *widget)
+{
+    widget->installEventFilter(this);
+}
+
+QString StartupTimeline::report() const
+{
+    QMutexLocker locker(&m_lock);
+
+    QString result = QStringLiteral("%1 %2 %3 %4 %5 %6\n")
+        .arg(QStringLiteral("phase"), -20)
+        .arg(QStringLiteral("start ms"), 9)
+        .arg(QStringLiteral("wall ms"), 9)
+        .arg(QStringLiteral("cpu ms"), 9)
+        .arg(QStringLiteral("items"), 9)
+        .arg(QStringLiteral("peak RSS KiB"), 13);
+
+    for(int i = 0; i < PhaseCount; ++i) {
+        const PhaseRecord &record = m_phases[i];
+        const QString name = QString::fromLatin1(phaseName(Phase(i)));
+
+        if(record.finished < 0) {
+            result += QStringLiteral("%1 %2\n").arg(name, -20)
+                .arg(record.started < 0 ? QStringLiteral("not run") : QStringLiteral("running"), 9);
+            continue;
+        }
+
+        result += QStringLiteral("%1 %2 %3 %4 %5 %6\n")
+            .arg(name, -20)
+            .arg(record.started, 9)
+            .arg(record.finished - record.started, 9)
+            .arg(record.cpuMsecs, 9)
+            .arg(record.items, 9)
+            .arg(record.peakRssKiB, 13);
+    }
+
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// protected methods
+////////////////////////////////////////////////////////////////////////////////
+
+bool StartupTimeline::eventFilter(QObject *watched, QEvent *event)
+{
+    if(event->type() == QEvent::Paint) {
+        watched->removeEventFilter(this);
+        end(FirstPaint);
+    }
+
+    return QObject::eventFilter(watched, event);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// private methods
+////////////////////////////////////////////////////////////////////////////////
+
+StartupTimeline::StartupTimeline()
+{
+    m_clock.start();
+
+    // Everything up to the first paint counts towards it.
+    begin(FirstPaint);
+}
+
+StartupTimeline::Usage StartupTimeline::currentUsage() // static
+{
+    Usage usage;
+
+#ifdef Q_OS_UNIX
+    struct rusage ru;
+    if(getrusage(RUSAGE_SELF, &ru) == 0) {
+        usage.cpuMsecs = (qint64(ru.ru_utime.tv_sec) + ru.ru_stime.tv_sec) * 1000 +
+                         (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1000;
+#ifdef Q_OS_MACOS
+        usage.peakRssKiB = ru.ru_maxrss / 1024; // Bytes on macOS
+#else
+        usage.peakRssKiB = ru.ru_maxrss;
+#endif
+    }
+#endif
+
+    return usage;
+}
+
+const char *StartupTimeline::phaseName(Phase phase) // static
+{
+    switch(phase) {
+    case CoverDatabaseLoad:
+        return "cover database load";
+    case CacheLoad:
+        return "cache load";
+    case ItemInsertion:
+        return "item insertion";
+    case Sort:
+        return "sort";
+    case PlaylistRestore:
+        return "playlist restore";
+    case ConsistencyCheck:
+        return "consistency check";
+    case FolderScan:
+        return "folder scan";
+    case FirstPaint:
+        return "first paint";
+    default:
+        return "unknown";
+    }
+}
+
+// vim: set et sw=4 tw=0 sta:
@@ -0,0 +1,119 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JUK_STARTUPTIMELINE_H
+#define JUK_STARTUPTIMELINE_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+
+class QWidget;
+
+/**
+ * Records how long each phase of starting up takes, so that startup
+ * regressions can be tracked between releases.  Each phase is only recorded
+ * the first time it runs; later rescans and the like are ignored.
+ *
+ * Phases run on the GUI thread and some of them overlap (the cache is decoded
+ * while items are being inserted), so the CPU time of a phase is the CPU time
+ * used by the whole process, all threads included, while it ran.
+ *
+ * The timeline is printed to stderr once the folder scan finishes if JuK was
+ * started with --startup-profile, and is available over D-Bus from
+ * org.kde.juk.collection.startupProfile.
+ */
+
+class StartupTimeline : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Phase {
+        CoverDatabaseLoad,
+        CacheLoad,
+        ItemInsertion,
+        Sort,
+        PlaylistRestore,
+        ConsistencyCheck,
+        FolderScan,
+        FirstPaint,
+        PhaseCount
+    };
+
+    /**
+     * The timeline starts counting the first time this is called, which
+     * should be as early as possible in main().
+     */
+    static StartupTimeline *instance();
+
+    void begin(Phase phase);
+
+    /**
+     * Ends \a phase, which handled \a items items (tracks, playlists, ...)
+     * in addition to those passed to addItems().
+     */
+    void end(Phase phase, int items = 0);
+
+    void addItems(Phase phase, int items);
+
+    /**
+     * Ends the FirstPaint phase when \a widget is first painted.
+     */
+    void watchFirstPaint(QWidget *widget);
+
+    void setPrintWhenFinished(bool print) { m_printWhenFinished = print; }
+
+    /**
+     * Returns the timeline as a table with one line per phase.
+     */
+    QString report() const;
+
+protected:
+    virtual bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    StartupTimeline();
+
+    struct Usage
+    {
+        qint64 cpuMsecs = 0;
+        qint64 peakRssKiB = 0;
+    };
+
+    static Usage currentUsage();
+    static const char *phaseName(Phase phase);
+
+    struct PhaseRecord
+    {
+        qint64 started = -1;  // msecs since the timeline started
+        qint64 finished = -1;
+        qint64 cpuAtStart = 0;
+        qint64 cpuMsecs = 0;
+        qint64 peakRssKiB = 0;
+        int items = 0;
+    };
+
+    mutable QMutex m_lock;
+    QElapsedTimer m_clock;
+    PhaseRecord m_phases[PhaseCount];
+    bool m_printWhenFinished = false;
+};
+
+#endif
+
+// vim: set et sw=4 tw=0 sta:
@@ -16,6 +16,8 @@
 #include "stringshare.h"
 
 #include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
 
 const int SIZE = 8191;
 
@@ -40,6 +42,7 @@ static unsigned num_hits     = 0;
 
 struct StringShare::Data
 {
+    QMutex   lock; // Tags are also loaded from worker threads
     QString  qstringHash [SIZE];
 };
 
@@ -53,9 +56,11 @@ QString StringShare::tryShare(const QString& in)
 {
     uint index = qHash(in) % SIZE;
 
+    Data* dat = data();
+    QMutexLocker locker(&dat->lock);
+
     num_attempts++;
 
-    Data* dat = data();
     if (dat->qstringHash[index] == in) {
         // Match
         num_hits++;
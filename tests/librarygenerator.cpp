@@ -0,0 +1,712 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Writes a synthetic music library for measuring how fast JuK scans and reads
+// tags, without needing any real music.  Run it as
+//
+//     librarygenerator --tracks 100k /tmp/library
+//
+// The files are tiny but valid MP3, FLAC, Ogg Vorbis and MP4 files which
+// TagLib reads like the real thing, their audio just isn't playable.  Artists,
+// albums, genres and years follow a skewed distribution similar to a real
+// collection, including some untagged tracks and names in other scripts.
+// The same seed always produces the same library.
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <QVector>
+#include <QtConcurrent>
+#include <QtEndian>
+
+#include <fileref.h>
+#include <tag.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace {
+
+enum Format { MP3, FLAC, OggVorbis, MP4 };
+
+struct Track
+{
+    QString fileName;
+    QString title;
+    QString artist;
+    int number;
+    int seconds;
+    bool tagged;
+};
+
+struct Album
+{
+    QString directory;
+    QString artist;
+    QString title;
+    QString genre;
+    int year;
+    Format format;
+    QVector<Track> tracks;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// minimal media files
+////////////////////////////////////////////////////////////////////////////////
+
+void appendU16BE(QByteArray &data, quint16 value)
+{
+    data.append(char(value >> 8));
+    data.append(char(value));
+}
+
+void appendU32BE(QByteArray &data, quint32 value)
+{
+    appendU16BE(data, quint16(value >> 16));
+    appendU16BE(data, quint16(value));
+}
+
+void appendU64BE(QByteArray &data, quint64 value)
+{
+    appendU32BE(data, quint32(value >> 32));
+    appendU32BE(data, quint32(value));
+}
+
+void appendU32LE(QByteArray &data, quint32 value)
+{
+    for(int i = 0; i < 4; ++i)
+        data.append(char(value >> (8 * i)));
+}
+
+void appendU64LE(QByteArray &data, quint64 value)
+{
+    appendU32LE(data, quint32(value));
+    appendU32LE(data, quint32(value >> 32));
+}
+
+QByteArray mp3File()
+{
+    // MPEG-1 Layer III frames at 128 kbps and 44.1 kHz, 417 bytes each, with
+    // silent side info.  Without a Xing header the length is estimated from
+    // the file size, so it is always short.
+    static const char header[] = { char(0xff), char(0xfb), char(0x90), char(0x40) };
+    static const int frameSize = 417;
+    static const int frameCount = 8;
+
+    QByteArray data(frameSize * frameCount, '\0');
+    for(int i = 0; i < frameCount; ++i)
+        data.replace(i * frameSize, 4, header, 4);
+
+    return data;
+}
+
+QByteArray flacFile(int seconds)
+{
+    // Just a STREAMINFO block, the length comes from its sample count.
+    QByteArray data("fLaC");
+    data.append(char(0x80)); // Last metadata block, STREAMINFO
+    data.append('\0');
+    data.append('\0');
+    data.append(char(34));
+
+    appendU16BE(data, 4096); // Minimum and maximum block size
+    appendU16BE(data, 4096);
+    data.append(QByteArray(6, '\0')); // Frame sizes are unknown
+
+    const quint64 samples = quint64(seconds) * 44100;
+    appendU64BE(data, (quint64(44100) << 44) | // Sample rate
+                      (quint64(1) << 41) |     // Two channels
+                      (quint64(15) << 36) |    // 16 bits per sample
+                      samples);
+    data.append(QByteArray(16, '\0')); // MD5 of the audio
+
+    // Stands in for the audio frames.
+    data.append(QByteArray(2048, '\0'));
+    return data;
+}
+
+quint32 oggChecksum(const QByteArray &page)
+{
+    static const QVector<quint32> table = [] {
+        QVector<quint32> table(256);
+        for(quint32 i = 0; i < 256; ++i) {
+            quint32 r = i << 24;
+            for(int j = 0; j < 8; ++j)
+                r = (r & 0x80000000) ? (r << 1) ^ 0x04c11db7 : r << 1;
+            table[i] = r;
+        }
+        return table;
+    }();
+
+    quint32 crc = 0;
+    for(const char c : page)
+        crc = (crc << 8) ^ table[((crc >> 24) ^ quint8(c)) & 0xff];
+
+    return crc;
+}
+
+QByteArray oggPage(const QVector<QByteArray> &packets, quint8 flags, quint64 granule, quint32 sequence)
+{
+    QByteArray lacing;
+    QByteArray body;
+
+    for(const auto &packet : packets) {
+        int size = packet.size();
+        for(; size >= 255; size -= 255)
+            lacing.append(char(255));
+        lacing.append(char(size));
+        body += packet;
+    }
+
+    QByteArray page("OggS");
+    page.append('\0'); // Version
+    page.append(char(flags));
+    appendU64LE(page, granule);
+    appendU32LE(page, 0x4a754b21); // Serial number
+    appendU32LE(page, sequence);
+    appendU32LE(page, 0); // Checksum, filled in below
+    page.append(char(lacing.size()));
+    page += lacing;
+    page += body;
+
+    qToLittleEndian<quint32>(oggChecksum(page), page.data() + 22);
+    return page;
+}
+
+QByteArray oggVorbisFile(int seconds)
+{
+    QByteArray identification("\x01vorbis", 7);
+    appendU32LE(identification, 0);      // Version
+    identification.append(char(2));     // Channels
+    appendU32LE(identification, 44100); // Sample rate
+    appendU32LE(identification, 0);      // Maximum bitrate
+    appendU32LE(identification, 128000); // Nominal bitrate
+    appendU32LE(identification, 0);      // Minimum bitrate
+    identification.append(char(0xb8));  // Block sizes 256 and 2048
+    identification.append(char(1));     // Framing
+
+    const QByteArray vendor("JuK library generator");
+    QByteArray comment("\x03vorbis", 7);
+    appendU32LE(comment, vendor.size());
+    comment += vendor;
+    appendU32LE(comment, 0);
+    comment.append(char(1));
+
+    // TagLib keeps the setup header as it is, so it needn't be decodable.
+    QByteArray setup("\x05vorbis", 7);
+    setup.append(QByteArray(64, '\0'));
+
+    const QVector<QByteArray> audio(16, QByteArray(128, '\0'));
+
+    return oggPage({ identification }, 0x02, 0, 0) +
+           oggPage({ comment, setup }, 0x00, 0, 1) +
+           oggPage(audio, 0x04, quint64(seconds) * 44100, 2);
+}
+
+QByteArray atom(const char *type, const QByteArray &payload)
+{
+    QByteArray data;
+    appendU32BE(data, 8 + payload.size());
+    data.append(type, 4);
+    data += payload;
+    return data;
+}
+
+QByteArray mp4Matrix()
+{
+    QByteArray data;
+    for(quint32 value : { 0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000 })
+        appendU32BE(data, value);
+    return data;
+}
+
+QByteArray mp4Movie(int seconds, int frames, int frameSize, quint32 audioOffset)
+{
+    QByteArray mvhd;
+    appendU32BE(mvhd, 0); // Version and flags
+    appendU32BE(mvhd, 0); // Creation and modification time
+    appendU32BE(mvhd, 0);
+    appendU32BE(mvhd, 1000); // Time scale
+    appendU32BE(mvhd, seconds * 1000);
+    appendU32BE(mvhd, 0x00010000); // Rate
+    appendU16BE(mvhd, 0x0100); // Volume
+    mvhd.append(QByteArray(10, '\0'));
+    mvhd += mp4Matrix();
+    mvhd.append(QByteArray(24, '\0'));
+    appendU32BE(mvhd, 2); // Next track ID
+
+    QByteArray tkhd;
+    appendU32BE(tkhd, 0x00000007); // Enabled, in movie and in preview
+    appendU32BE(tkhd, 0);
+    appendU32BE(tkhd, 0);
+    appendU32BE(tkhd, 1); // Track ID
+    appendU32BE(tkhd, 0);
+    appendU32BE(tkhd, seconds * 1000);
+    tkhd.append(QByteArray(8, '\0'));
+    appendU16BE(tkhd, 0); // Layer
+    appendU16BE(tkhd, 0); // Alternate group
+    appendU16BE(tkhd, 0x0100); // Volume
+    appendU16BE(tkhd, 0);
+    tkhd += mp4Matrix();
+    appendU32BE(tkhd, 0); // Width and height
+    appendU32BE(tkhd, 0);
+
+    QByteArray mdhd;
+    appendU32BE(mdhd, 0);
+    appendU32BE(mdhd, 0);
+    appendU32BE(mdhd, 0);
+    appendU32BE(mdhd, 44100); // Time scale
+    appendU32BE(mdhd, quint32(seconds) * 44100);
+    appendU16BE(mdhd, 0x55c4); // Undetermined language
+    appendU16BE(mdhd, 0);
+
+    QByteArray hdlr;
+    appendU32BE(hdlr, 0);
+    appendU32BE(hdlr, 0);
+    hdlr.append("soun", 4);
+    hdlr.append(QByteArray(12, '\0'));
+    hdlr.append('\0'); // Empty name
+
+    QByteArray smhd;
+    appendU32BE(smhd, 0);
+    appendU32BE(smhd, 0); // Balance
+
+    QByteArray url;
+    appendU32BE(url, 1); // Data is in this file
+    QByteArray dref;
+    appendU32BE(dref, 0);
+    appendU32BE(dref, 1);
+    dref += atom("url ", url);
+
+    // AAC LC, two channels at 44.1 kHz and 128 kbps.
+    QByteArray esds;
+    appendU32BE(esds, 0);
+    esds.append("\x03\x19\x00\x01\x00", 5);         // ES descriptor
+    esds.append("\x04\x11\x40\x15\x00\x00\x00", 7); // Decoder config
+    appendU32BE(esds, 128000);
+    appendU32BE(esds, 128000);
+    esds.append("\x05\x02\x12\x10", 4);             // Decoder specific info
+    esds.append("\x06\x01\x02", 3);                 // SL config
+
+    QByteArray mp4a;
+    mp4a.append(QByteArray(6, '\0'));
+    appendU16BE(mp4a, 1); // Data reference index
+    appendU32BE(mp4a, 0); // Version, revision and vendor
+    appendU32BE(mp4a, 0);
+    appendU16BE(mp4a, 2);  // Channels
+    appendU16BE(mp4a, 16); // Bits per sample
+    appendU32BE(mp4a, 0);  // Compression ID and packet size
+    appendU32BE(mp4a, 44100u << 16);
+    mp4a += atom("esds", esds);
+
+    QByteArray stsd;
+    appendU32BE(stsd, 0);
+    appendU32BE(stsd, 1);
+    stsd += atom("mp4a", mp4a);
+
+    QByteArray stts;
+    appendU32BE(stts, 0);
+    appendU32BE(stts, 1);
+    appendU32BE(stts, frames);
+    appendU32BE(stts, 1024);
+
+    QByteArray stsc;
+    appendU32BE(stsc, 0);
+    appendU32BE(stsc, 1);
+    appendU32BE(stsc, 1);
+    appendU32BE(stsc, frames);
+    appendU32BE(stsc, 1);
+
+    QByteArray stsz;
+    appendU32BE(stsz, 0);
+    appendU32BE(stsz, frameSize);
+    appendU32BE(stsz, frames);
+
+    QByteArray stco;
+    appendU32BE(stco, 0);
+    appendU32BE(stco, 1);
+    appendU32BE(stco, audioOffset);
+
+    const QByteArray stbl = atom("stsd", stsd) + atom("stts", stts) + atom("stsc", stsc) +
+                            atom("stsz", stsz) + atom("stco", stco);
+    const QByteArray minf = atom("smhd", smhd) + atom("dinf", atom("dref", dref)) +
+                            atom("stbl", stbl);
+    const QByteArray mdia = atom("mdhd", mdhd) + atom("hdlr", hdlr) + atom("minf", minf);
+    const QByteArray trak = atom("tkhd", tkhd) + atom("mdia", mdia);
+
+    return atom("moov", atom("mvhd", mvhd) + atom("trak", trak));
+}
+
+QByteArray mp4File(int seconds)
+{
+    static const int frames = 16;
+    static const int frameSize = 128;
+
+    QByteArray ftyp("M4A ");
+    appendU32BE(ftyp, 0);
+    ftyp.append("M4A mp42isom");
+    const QByteArray fileType = atom("ftyp", ftyp);
+
+    // The size of the movie doesn't depend on where the audio starts.
+    const int movieSize = mp4Movie(seconds, frames, frameSize, 0).size();
+    const quint32 audioOffset = fileType.size() + movieSize + 8;
+
+    return fileType + mp4Movie(seconds, frames, frameSize, audioOffset) +
+           atom("mdat", QByteArray(frames * frameSize, '\0'));
+}
+
+QByteArray mediaFile(Format format, int seconds)
+{
+    switch(format) {
+    case MP3:
+        return mp3File();
+    case FLAC:
+        return flacFile(seconds);
+    case OggVorbis:
+        return oggVorbisFile(seconds);
+    case MP4:
+        return mp4File(seconds);
+    }
+
+    return QByteArray();
+}
+
+const char *extension(Format format)
+{
+    switch(format) {
+    case MP3:
+        return "mp3";
+    case FLAC:
+        return "flac";
+    case OggVorbis:
+        return "ogg";
+    case MP4:
+        return "m4a";
+    }
+
+    return "";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// library layout and tags
+////////////////////////////////////////////////////////////////////////////////
+
+class NameGenerator
+{
+public:
+    explicit NameGenerator(QRandomGenerator *random) : m_random(random)
+    {
+    }
+
+    QString word()
+    {
+        static const char *const onsets[] = {
+            "b", "br", "c", "ch", "d", "dr", "f", "g", "gl", "h", "j", "k", "l",
+            "m", "n", "p", "pr", "r", "s", "sh", "st", "t", "tr", "v", "w", "z"
+        };
+        static const char *const vowels[] = {
+            "a", "e", "i", "o", "u", "ai", "ea", "ee", "oo", "ou", "y"
+        };
+        static const char *const codas[] = {
+            "", "", "", "n", "r", "s", "t", "l", "ck", "nd", "rk", "ng", "st"
+        };
+
+        QString word;
+        const int syllables = 1 + bounded(3);
+        for(int i = 0; i < syllables; ++i) {
+            word += QLatin1String(pick(onsets));
+            word += QLatin1String(pick(vowels));
+        }
+        word += QLatin1String(pick(codas));
+        word[0] = word[0].toUpper();
+
+        return word;
+    }
+
+    QString words(int min, int max)
+    {
+        // A few names in other scripts and with accents, as real libraries
+        // have them.
+        static const char *const foreign[] = {
+            "Café", "Über", "Søren", "Niño", "Ærø", "Здравствуй", "Город",
+            "夜明け", "東京", "사랑", "Ελπίδα", "Śnieg"
+        };
+
+        QStringList result;
+        const int count = min + bounded(max - min + 1);
+        for(int i = 0; i < count; ++i) {
+            if(bounded(50) == 0)
+                result << QString::fromUtf8(pick(foreign));
+            else
+                result << word();
+        }
+
+        return result.join(QLatin1Char(' '));
+    }
+
+    int bounded(int max)
+    {
+        return int(m_random->bounded(quint32(max)));
+    }
+
+private:
+    template<size_t N>
+    const char *pick(const char *const (&list)[N])
+    {
+        return list[bounded(int(N))];
+    }
+
+    QRandomGenerator *m_random;
+};
+
+// Picks ranks so that a few artists have most of the albums, as in a real
+// collection.
+class ZipfDistribution
+{
+public:
+    ZipfDistribution(int count, double exponent)
+    {
+        m_cumulative.reserve(count);
+
+        double sum = 0;
+        for(int rank = 1; rank <= count; ++rank) {
+            sum += 1.0 / std::pow(rank, exponent);
+            m_cumulative.append(sum);
+        }
+    }
+
+    int pick(QRandomGenerator *random) const
+    {
+        const double value = random->generateDouble() * m_cumulative.last();
+        return int(std::lower_bound(m_cumulative.begin(), m_cumulative.end(), value) -
+                   m_cumulative.begin());
+    }
+
+private:
+    QVector<double> m_cumulative;
+};
+
+QString fileSystemName(QString name)
+{
+    name.replace(QLatin1Char('/'), QLatin1Char('_'));
+    return name;
+}
+
+QVector<Album> planLibrary(int trackCount, quint32 seed)
+{
+    static const char *const genres[] = {
+        "Rock", "Rock", "Rock", "Pop", "Pop", "Alternative", "Electronic",
+        "Electronic", "Jazz", "Classical", "Hip-Hop", "Metal", "Folk", "Blues",
+        "Soundtrack", "Country", "Reggae", "Ambient", "Punk", "Soul"
+    };
+    static const int genreCount = sizeof(genres) / sizeof(genres[0]);
+
+    QRandomGenerator random(seed);
+    NameGenerator names(&random);
+
+    // Roughly one artist for every sixty tracks.
+    const int artistCount = qMax(10, trackCount / 60);
+    QStringList artists;
+    QStringList artistGenres;
+    QVector<int> artistEras;
+
+    for(int i = 0; i < artistCount; ++i) {
+        QString artist = names.words(1, 3);
+        if(names.bounded(8) == 0)
+            artist.prepend(QLatin1String("The "));
+
+        artists << artist;
+        artistGenres << QLatin1String(genres[names.bounded(genreCount)]);
+        artistEras << 1960 + names.bounded(60);
+    }
+
+    const ZipfDistribution popularity(artistCount, 1.1);
+
+    QVector<Album> albums;
+    int tracks = 0;
+
+    while(tracks < trackCount) {
+        Album album;
+        const int artist = popularity.pick(&random);
+        const bool compilation = names.bounded(20) == 0;
+
+        album.artist = compilation ? QStringLiteral("Various Artists") : artists[artist];
+        album.title = names.words(1, 4);
+        album.genre = names.bounded(25) == 0 ? QString() : artistGenres[artist];
+        album.year = names.bounded(16) == 0 ? 0 :
+            qBound(1950, artistEras[artist] + names.bounded(25), 2026);
+
+        // Albums are mostly all in one format.
+        const int format = names.bounded(100);
+        album.format = format < 55 ? MP3 : format < 75 ? FLAC : format < 90 ? OggVorbis : MP4;
+
+        album.directory = fileSystemName(album.artist) + QLatin1Char('/') +
+            (album.year ? QString::number(album.year) + QLatin1String(" - ") : QString()) +
+            fileSystemName(album.title);
+
+        const int trackTotal = qMin(6 + names.bounded(13), trackCount - tracks);
+        for(int number = 1; number <= trackTotal; ++number) {
+            Track track;
+            track.title = names.words(1, 5);
+            track.artist = compilation ? artists[popularity.pick(&random)] : album.artist;
+            track.number = names.bounded(30) == 0 ? 0 : number;
+            track.seconds = 90 + names.bounded(360);
+            track.tagged = names.bounded(100) != 0;
+            track.fileName = QStringLiteral("%1 - %2.%3")
+                .arg(number, 2, 10, QLatin1Char('0'))
+                .arg(fileSystemName(track.title))
+                .arg(QLatin1String(extension(album.format)));
+
+            album.tracks << track;
+        }
+
+        tracks += trackTotal;
+        albums << album;
+    }
+
+    return albums;
+}
+
+TagLib::String toTagLib(const QString &value)
+{
+    return TagLib::String(value.toUtf8().constData(), TagLib::String::UTF8);
+}
+
+bool writeAlbum(const QDir &root, const Album &album)
+{
+    if(!root.mkpath(album.directory))
+        return false;
+
+    for(const auto &track : album.tracks) {
+        const QString path = root.filePath(album.directory + QLatin1Char('/') + track.fileName);
+
+        QFile file(path);
+        if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+           file.write(mediaFile(album.format, track.seconds)) < 0)
+        {
+            return false;
+        }
+        file.close();
+
+        if(!track.tagged)
+            continue;
+
+        TagLib::FileRef ref(QFile::encodeName(path).constData(), false);
+        if(ref.isNull() || !ref.tag())
+            return false;
+
+        ref.tag()->setTitle(toTagLib(track.title));
+        ref.tag()->setArtist(toTagLib(track.artist));
+        ref.tag()->setAlbum(toTagLib(album.title));
+        ref.tag()->setGenre(toTagLib(album.genre));
+        ref.tag()->setYear(album.year);
+        ref.tag()->setTrack(track.number);
+
+        if(!ref.save())
+            return false;
+    }
+
+    return true;
+}
+
+int parseCount(const QString &value)
+{
+    QString number = value.trimmed();
+    int multiplier = 1;
+
+    if(number.endsWith(QLatin1Char('k'), Qt::CaseInsensitive))
+        multiplier = 1000;
+    else if(number.endsWith(QLatin1Char('M')))
+        multiplier = 1000 * 1000;
+
+    if(multiplier > 1)
+        number.chop(1);
+
+    bool ok;
+    const int count = number.toInt(&ok);
+    return ok ? count * multiplier : -1;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("librarygenerator"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Writes a synthetic music library for benchmarking JuK."));
+    parser.addHelpOption();
+    parser.addOption({ QStringLiteral("tracks"),
+                       QStringLiteral("Number of tracks, such as 10k, 100k or 1M."),
+                       QStringLiteral("count"), QStringLiteral("10k") });
+    parser.addOption({ QStringLiteral("seed"),
+                       QStringLiteral("Seed for the random layout and tags."),
+                       QStringLiteral("seed"), QStringLiteral("1") });
+    parser.addPositionalArgument(QStringLiteral("directory"),
+                                 QStringLiteral("Where to write the library."));
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    const int trackCount = parseCount(parser.value(QStringLiteral("tracks")));
+    if(parser.positionalArguments().count() != 1 || trackCount <= 0)
+        parser.showHelp(1);
+
+    const QDir root(parser.positionalArguments().first());
+    if(!root.mkpath(QStringLiteral("."))) {
+        err << "Unable to create " << root.path() << '\n';
+        return 1;
+    }
+
+    const QVector<Album> albums = planLibrary(trackCount, parser.value(QStringLiteral("seed")).toUInt());
+    out << "Writing " << trackCount << " tracks in " << albums.count() << " albums to "
+        << root.absolutePath() << '\n';
+    out.flush();
+
+    std::atomic<int> written(0);
+    std::atomic<bool> failed(false);
+
+    QtConcurrent::blockingMap(albums, [&](const Album &album) {
+        if(failed)
+            return;
+
+        if(!writeAlbum(root, album)) {
+            failed = true;
+            return;
+        }
+
+        const int total = written += album.tracks.count();
+        const int before = total - album.tracks.count();
+        if(total / 10000 != before / 10000)
+            QTextStream(stdout) << total << " tracks written\n";
+    });
+
+    if(failed) {
+        err << "Unable to write the library to " << root.path() << '\n';
+        return 1;
+    }
+
+    out << "Done\n";
+    return 0;
+}
+
+// vim: set et sw=4 tw=0 sta:
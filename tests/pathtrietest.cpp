@@ -0,0 +1,92 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pathtrie.h"
+#include <QTest>
+
+class PathTrieTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testRuleFor_data();
+    void testRuleFor();
+    void testEmpty();
+    void testReplaceRule();
+};
+
+Q_DECLARE_METATYPE(PathTrie::Rule)
+
+void PathTrieTest::testRuleFor_data()
+{
+    QTest::addColumn<QString>("path");
+    QTest::addColumn<PathTrie::Rule>("rule");
+
+    QTest::newRow("folder") << QStringLiteral("/home/user/Music") << PathTrie::Include;
+    QTest::newRow("trailing slash") << QStringLiteral("/home/user/Music/") << PathTrie::Include;
+    QTest::newRow("within folder") << QStringLiteral("/home/user/Music/Artist/track.mp3") << PathTrie::Include;
+    QTest::newRow("parent of folder") << QStringLiteral("/home/user") << PathTrie::NoRule;
+    QTest::newRow("outside") << QStringLiteral("/tmp/track.mp3") << PathTrie::NoRule;
+    QTest::newRow("name prefix") << QStringLiteral("/home/user/Musical/track.mp3") << PathTrie::NoRule;
+    QTest::newRow("excluded") << QStringLiteral("/home/user/Music/Podcasts") << PathTrie::Exclude;
+    QTest::newRow("within excluded") << QStringLiteral("/home/user/Music/Podcasts/show/1.mp3") << PathTrie::Exclude;
+    QTest::newRow("excluded name prefix") << QStringLiteral("/home/user/Music/Podcasts2") << PathTrie::Include;
+    QTest::newRow("included again") << QStringLiteral("/home/user/Music/Podcasts/Keep/1.mp3") << PathTrie::Include;
+    QTest::newRow("second folder") << QStringLiteral("/mnt/nas/music/a.flac") << PathTrie::Include;
+    QTest::newRow("root") << QStringLiteral("/") << PathTrie::NoRule;
+}
+
+void PathTrieTest::testRuleFor()
+{
+    QFETCH(QString, path);
+    QFETCH(PathTrie::Rule, rule);
+
+    const PathTrie trie({ "/home/user/Music", "/mnt/nas/music", "/home/user/Music/Podcasts/Keep" },
+                        { "/home/user/Music/Podcasts" });
+
+    QCOMPARE(trie.ruleFor(path), rule);
+    QCOMPARE(trie.contains(path), rule == PathTrie::Include);
+    QCOMPARE(trie.isExcluded(path), rule == PathTrie::Exclude);
+}
+
+void PathTrieTest::testEmpty()
+{
+    PathTrie trie;
+    QVERIFY(trie.isEmpty());
+    QCOMPARE(trie.ruleFor("/home/user/Music"), PathTrie::NoRule);
+
+    trie.insert("/home/user/Music", PathTrie::Include);
+    QVERIFY(!trie.isEmpty());
+
+    trie.clear();
+    QVERIFY(trie.isEmpty());
+    QCOMPARE(trie.ruleFor("/home/user/Music"), PathTrie::NoRule);
+}
+
+void PathTrieTest::testReplaceRule()
+{
+    PathTrie trie;
+    trie.insert("/music", PathTrie::Include);
+    trie.insert("/music", PathTrie::Exclude);
+
+    QVERIFY(trie.isExcluded("/music/a.mp3"));
+}
+
+QTEST_GUILESS_MAIN(PathTrieTest)
+
+// vim: set et sw=4 tw=0 sta:
+
+#include "pathtrietest.moc"
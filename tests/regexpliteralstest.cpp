@@ -0,0 +1,100 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "regexpliterals.h"
+#include <QTest>
+
+class RegExpLiteralsTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testAlternatives_data();
+    void testAlternatives();
+    void testMinLength();
+};
+
+Q_DECLARE_METATYPE(QRegExp::PatternSyntax)
+
+// Alternatives separated by '|', the strings of each by '+'.
+static QString format(const RegExpLiterals &literals)
+{
+    QStringList alternatives;
+    const auto all = literals.alternatives();
+    for(const QStringList &alternative : all)
+        alternatives.append(alternative.join(QLatin1Char('+')));
+    return alternatives.join(QLatin1Char('|'));
+}
+
+void RegExpLiteralsTest::testAlternatives_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<QRegExp::PatternSyntax>("syntax");
+    QTest::addColumn<QString>("literals");
+
+    const QRegExp::PatternSyntax regExp = QRegExp::RegExp;
+
+    QTest::newRow("literal") << QStringLiteral("live") << regExp << QStringLiteral("live");
+    QTest::newRow("alternation") << QStringLiteral("live|acoustic|demo") << regExp << QStringLiteral("live|acoustic|demo");
+    QTest::newRow("wildcard between") << QStringLiteral("foo.*bar") << regExp << QStringLiteral("foo+bar");
+    QTest::newRow("group") << QStringLiteral("(live|demo) version") << regExp << QStringLiteral("live+ version|demo+ version");
+    QTest::newRow("non-capturing group") << QStringLiteral("(?:live|demo)s") << regExp << QStringLiteral("live+s|demo+s");
+    QTest::newRow("optional group") << QStringLiteral("(remix )?edit") << regExp << QStringLiteral("edit");
+    QTest::newRow("lookahead") << QStringLiteral("(?=abc)def") << regExp << QStringLiteral("def");
+    QTest::newRow("optional character") << QStringLiteral("colou?r") << regExp << QStringLiteral("colo+r");
+    QTest::newRow("repeated character") << QStringLiteral("ab+c") << regExp << QStringLiteral("ab+c");
+    QTest::newRow("counted") << QStringLiteral("ab{0,2}cd") << regExp << QStringLiteral("a+cd");
+    QTest::newRow("at most") << QStringLiteral("ab{,2}cd") << regExp << QStringLiteral("a+cd");
+    QTest::newRow("exactly once") << QStringLiteral("ab{1}cd") << regExp << QStringLiteral("abcd");
+    QTest::newRow("class") << QStringLiteral("[Ll]ive") << regExp << QStringLiteral("ive");
+    QTest::newRow("class with bracket") << QStringLiteral("[a\\]]bc") << regExp << QStringLiteral("bc");
+    QTest::newRow("escaped class") << QStringLiteral("\\d+ remix") << regExp << QStringLiteral(" remix");
+    QTest::newRow("escaped character") << QStringLiteral("x\\.y") << regExp << QStringLiteral("x.y");
+    QTest::newRow("anchors") << QStringLiteral("^the end$") << regExp << QStringLiteral("the end");
+    QTest::newRow("anything") << QStringLiteral(".*") << regExp << QString();
+    QTest::newRow("anything alternative") << QStringLiteral("live|.*") << regExp << QString();
+    QTest::newRow("empty alternative") << QStringLiteral("live|") << regExp << QString();
+    QTest::newRow("invalid") << QStringLiteral("(live") << regExp << QString();
+    QTest::newRow("fixed string") << QStringLiteral("a.b") << QRegExp::FixedString << QStringLiteral("a.b");
+    QTest::newRow("wildcard") << QStringLiteral("*live*.mp3") << QRegExp::Wildcard << QStringLiteral("live+.mp3");
+    QTest::newRow("wildcard class") << QStringLiteral("[0-9]x") << QRegExp::Wildcard << QStringLiteral("x");
+    QTest::newRow("unix wildcard") << QStringLiteral("a\\*b*") << QRegExp::WildcardUnix << QStringLiteral("a*b");
+}
+
+void RegExpLiteralsTest::testAlternatives()
+{
+    QFETCH(QString, pattern);
+    QFETCH(QRegExp::PatternSyntax, syntax);
+    QFETCH(QString, literals);
+
+    const RegExpLiterals result(QRegExp(pattern, Qt::CaseSensitive, syntax));
+
+    QCOMPARE(format(result), literals);
+    QCOMPARE(result.isEmpty(), literals.isEmpty());
+}
+
+void RegExpLiteralsTest::testMinLength()
+{
+    QCOMPARE(format(RegExpLiterals(QRegExp("abcd.ef"), 3)), QStringLiteral("abcd"));
+    QCOMPARE(format(RegExpLiterals(QRegExp("live|ep"), 3)), QString());
+    QVERIFY(RegExpLiterals(QRegExp("a.b.c"), 3).isEmpty());
+}
+
+QTEST_GUILESS_MAIN(RegExpLiteralsTest)
+
+// vim: set et sw=4 tw=0 sta:
+
+#include "regexpliteralstest.moc"
@@ -0,0 +1,273 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Measures how fast a music library is scanned, for use with a library from
+// librarygenerator:
+//
+//     scanbenchmark [--threads N] [--properties fast|average|accurate] [--cold] DIRECTORY
+//
+// DirectoryLoader needs the collection and the rest of the GUI, so this runs
+// the same stages with the same code instead: listing and classifying the
+// files with MediaFiles::classify() on one thread, and reading them through
+// a MediaProbe the way Tag and CoverInfo do on the others, connected by
+// BoundedQueues of the same size.
+//
+// Reports files per second along with the bytes read and the read and write
+// system calls made, as counted by the kernel in /proc/self/io.  With --cold
+// the files are dropped from the page cache first, which works for files
+// that haven't been changed since they were last written out.
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include <tag.h>
+#include <tfile.h>
+#include <audioproperties.h>
+
+#include <atomic>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "boundedqueue.h"
+#include "directoryloader.h"
+#include "mediafiles.h"
+#include "mediaprobe.h"
+
+namespace {
+
+struct IoCounters
+{
+    qint64 charactersRead = 0;  // Everything returned by read() and friends
+    qint64 bytesRead = 0;       // What actually came from storage
+    qint64 readCalls = 0;
+    qint64 writeCalls = 0;
+
+    static IoCounters current()
+    {
+        IoCounters counters;
+
+        QFile file(QStringLiteral("/proc/self/io"));
+        if(!file.open(QIODevice::ReadOnly))
+            return counters;
+
+        for(const QByteArray &line : file.readAll().split('\n')) {
+            const int colon = line.indexOf(':');
+            if(colon < 0)
+                continue;
+
+            const QByteArray key = line.left(colon);
+            const qint64 value = line.mid(colon + 1).trimmed().toLongLong();
+
+            if(key == "rchar")
+                counters.charactersRead = value;
+            else if(key == "read_bytes")
+                counters.bytesRead = value;
+            else if(key == "syscr")
+                counters.readCalls = value;
+            else if(key == "syscw")
+                counters.writeCalls = value;
+        }
+
+        return counters;
+    }
+
+    IoCounters operator-(const IoCounters &other) const
+    {
+        IoCounters difference;
+        difference.charactersRead = charactersRead - other.charactersRead;
+        difference.bytesRead = bytesRead - other.bytesRead;
+        difference.readCalls = readCalls - other.readCalls;
+        difference.writeCalls = writeCalls - other.writeCalls;
+        return difference;
+    }
+};
+
+double seconds(const timeval &time)
+{
+    return time.tv_sec + time.tv_usec / 1e6;
+}
+
+QString mebibytes(qint64 bytes)
+{
+    return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + QLatin1String(" MiB");
+}
+
+void evictFromCache(const QString &root)
+{
+    QDirIterator it(root, QDir::Files, QDirIterator::Subdirectories);
+
+    while(it.hasNext()) {
+        const int fd = ::open(QFile::encodeName(it.next()).constData(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+            continue;
+
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+}
+
+// Reads what Tag::setup() and CoverInfo read from each file.
+void readFiles(BoundedQueue<QString> *files, TagLib::AudioProperties::ReadStyle style,
+               std::atomic<qint64> *read, std::atomic<qint64> *failed)
+{
+    QString fileName;
+
+    while(files->pop(fileName)) {
+        const MediaProbe probe(fileName, style);
+        TagLib::File *file = probe.file();
+
+        if(!probe.isValid() || !file->tag()) {
+            ++*failed;
+            continue;
+        }
+
+        const TagLib::Tag *tag = file->tag();
+        (void) tag->title();
+        (void) tag->artist();
+        (void) tag->album();
+        (void) tag->genre();
+        (void) tag->comment();
+
+        if(file->audioProperties())
+            (void) file->audioProperties()->length();
+
+        (void) probe.hasEmbeddedArt();
+        ++*read;
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("scanbenchmark"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Measures how fast JuK scans a music library."));
+    parser.addHelpOption();
+    parser.addOption({ QStringLiteral("threads"),
+                       QStringLiteral("Number of tag reading threads, one per core by default."),
+                       QStringLiteral("count"), QString::number(QThread::idealThreadCount()) });
+    parser.addOption({ QStringLiteral("properties"),
+                       QStringLiteral("How audio properties are read: fast, average or accurate."),
+                       QStringLiteral("style"), QStringLiteral("fast") });
+    parser.addOption({ QStringLiteral("cold"),
+                       QStringLiteral("Drop the files from the page cache first.") });
+    parser.addPositionalArgument(QStringLiteral("directory"),
+                                 QStringLiteral("The library to scan."));
+    parser.process(app);
+
+    if(parser.positionalArguments().count() != 1)
+        parser.showHelp(1);
+
+    const QString root = QFileInfo(parser.positionalArguments().first()).canonicalFilePath();
+    const int threads = qMax(1, parser.value(QStringLiteral("threads")).toInt());
+
+    const QString styleName = parser.value(QStringLiteral("properties"));
+    TagLib::AudioProperties::ReadStyle style = TagLib::AudioProperties::Fast;
+    if(styleName == QLatin1String("average"))
+        style = TagLib::AudioProperties::Average;
+    else if(styleName == QLatin1String("accurate"))
+        style = TagLib::AudioProperties::Accurate;
+
+    QTextStream out(stdout);
+
+    if(root.isEmpty()) {
+        QTextStream(stderr) << "No such directory " << parser.positionalArguments().first() << '\n';
+        return 1;
+    }
+
+    if(parser.isSet(QStringLiteral("cold")))
+        evictFromCache(root);
+
+    // Classifying by extension is set up on first use, keep it out of the
+    // measurement.
+    MediaFiles::classify(root + QLatin1String("/warmup.mp3"));
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads + 1);
+
+    BoundedQueue<QString> mediaFiles(DirectoryLoader::MEDIA_FILE_QUEUE_SIZE);
+    std::atomic<qint64> listed(0), read(0), failed(0);
+    qint64 listingTime = 0;
+
+    const IoCounters ioBefore = IoCounters::current();
+    rusage usageBefore;
+    ::getrusage(RUSAGE_SELF, &usageBefore);
+
+    QElapsedTimer stopwatch;
+    stopwatch.start();
+
+    QFuture<void> listing = QtConcurrent::run(&pool, [&] {
+        QDirIterator it(root, QDir::Files | QDir::NoDotAndDotDot,
+                        QDirIterator::Subdirectories | QDirIterator::FollowSymlinks);
+
+        while(it.hasNext()) {
+            const QString fileName = it.next();
+            ++listed;
+
+            if(MediaFiles::classify(fileName) == MediaFiles::FileKind::Media)
+                mediaFiles.push(fileName);
+        }
+
+        mediaFiles.close();
+        listingTime = stopwatch.nsecsElapsed();
+    });
+
+    QVector<QFuture<void>> readers;
+    for(int i = 0; i < threads; ++i) {
+        readers << QtConcurrent::run(&pool, [&] {
+            readFiles(&mediaFiles, style, &read, &failed);
+        });
+    }
+
+    listing.waitForFinished();
+    for(auto &reader : readers)
+        reader.waitForFinished();
+
+    const double elapsed = stopwatch.nsecsElapsed() / 1e9;
+    const IoCounters io = IoCounters::current() - ioBefore;
+    rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+
+    out << "Listed " << listed << " files in " << QString::number(listingTime / 1e9, 'f', 2) << " s\n";
+    out << "Read " << read << " media files (" << failed << " unreadable) in "
+        << QString::number(elapsed, 'f', 2) << " s with " << threads << " threads: "
+        << QString::number(read / elapsed, 'f', 0) << " files/s\n";
+    out << "Read " << mebibytes(io.charactersRead) << " (" << mebibytes(io.bytesRead)
+        << " from storage) in " << io.readCalls << " read and " << io.writeCalls
+        << " write system calls, " << QString::number(double(io.readCalls) / qMax<qint64>(1, read), 'f', 1)
+        << " reads per file\n";
+    out << "CPU time " << QString::number(seconds(usage.ru_utime) - seconds(usageBefore.ru_utime), 'f', 2)
+        << " s user, " << QString::number(seconds(usage.ru_stime) - seconds(usageBefore.ru_stime), 'f', 2)
+        << " s system, " << (usage.ru_nvcsw - usageBefore.ru_nvcsw) << " voluntary and "
+        << (usage.ru_nivcsw - usageBefore.ru_nivcsw) << " involuntary context switches\n";
+
+    return 0;
+}
+
+// vim: set et sw=4 tw=0 sta:
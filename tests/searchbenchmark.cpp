@@ -0,0 +1,240 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Measures how many rows per second the search bar's matching gets through,
+// the way it was done before the search kernel and with it:
+//
+//     searchbenchmark [--rows N] [--seed N]
+//
+// Before, each cell was compared with QString::contains() ignoring case, and
+// exact matches lowercased both the cell and the query every time.  Now the
+// cells are folded once when an item is refreshed and compared exactly with
+// SearchKernel against a query folded once per search.  The rows are made
+// up of random words in mixed case, with some accented and non-Latin ones,
+// spread over the columns searched by default.
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+
+#include <functional>
+
+#include "searchkernel.h"
+
+namespace {
+
+const int COLUMNS = 6;     // Title, artist, album, genre, year and file name
+const int REPEATS = 5;
+
+typedef QVector<QString> Row;
+
+QString randomWord(QRandomGenerator &random)
+{
+    static const QStringList syllables = {
+        QStringLiteral("ka"), QStringLiteral("Ro"), QStringLiteral("mi"), QStringLiteral("LE"),
+        QStringLiteral("sun"), QStringLiteral("Ta"), QStringLiteral("beat"), QStringLiteral("Nor"),
+        QStringLiteral("é"), QStringLiteral("Ø"), QStringLiteral("ß"), QStringLiteral("Мо"),
+        QStringLiteral("зе"), QStringLiteral("ラ"), QStringLiteral("de"), QStringLiteral("Vi")
+    };
+
+    QString word;
+    const int count = 1 + random.bounded(4);
+    for(int i = 0; i < count; ++i)
+        word += syllables[random.bounded(syllables.size())];
+    return word;
+}
+
+QString randomText(QRandomGenerator &random, int maxWords)
+{
+    QStringList words;
+    const int count = 1 + random.bounded(maxWords);
+    for(int i = 0; i < count; ++i)
+        words.append(randomWord(random));
+    return words.join(QLatin1Char(' '));
+}
+
+QVector<Row> randomRows(QRandomGenerator &random, int count)
+{
+    QVector<Row> rows;
+    rows.reserve(count);
+
+    for(int i = 0; i < count; ++i) {
+        rows.append(Row {
+            randomText(random, 5),
+            randomText(random, 2),
+            randomText(random, 4),
+            randomText(random, 1),
+            QString::number(1950 + random.bounded(75)),
+            randomText(random, 5) + QLatin1String(".mp3")
+        });
+    }
+
+    return rows;
+}
+
+struct Result
+{
+    double rowsPerSecond;
+    qint64 matches;
+};
+
+// Runs \a matches for every row and query a few times and returns the best.
+Result measure(const QVector<Row> &rows, const QStringList &queries,
+               const std::function<bool(const Row &, int query)> &matches)
+{
+    Result result = { 0, 0 };
+
+    for(int repeat = 0; repeat < REPEATS; ++repeat) {
+        QElapsedTimer stopwatch;
+        stopwatch.start();
+
+        qint64 found = 0;
+        for(int query = 0; query < queries.size(); ++query) {
+            for(const Row &row : rows) {
+                if(matches(row, query))
+                    ++found;
+            }
+        }
+
+        const qint64 elapsed = qMax<qint64>(1, stopwatch.nsecsElapsed());
+        const double rate = double(rows.size()) * queries.size() / (elapsed / 1e9);
+
+        result.rowsPerSecond = qMax(result.rowsPerSecond, rate);
+        result.matches = found;
+    }
+
+    return result;
+}
+
+void report(QTextStream &out, const QString &name, const Result &before, const Result &after)
+{
+    out << name << ":\n"
+        << "  before: " << qRound64(before.rowsPerSecond) << " rows/s\n"
+        << "  after:  " << qRound64(after.rowsPerSecond) << " rows/s ("
+        << QString::number(after.rowsPerSecond / before.rowsPerSecond, 'f', 2) << "x)\n";
+
+    if(before.matches != after.matches) {
+        out << "  the matches differ: " << before.matches << " before, "
+            << after.matches << " after\n";
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("searchbenchmark"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Measures how fast JuK matches searches."));
+    parser.addHelpOption();
+    parser.addOption({ QStringLiteral("rows"),
+                       QStringLiteral("Number of rows to search."),
+                       QStringLiteral("count"), QStringLiteral("100000") });
+    parser.addOption({ QStringLiteral("seed"),
+                       QStringLiteral("Seed for the random rows."),
+                       QStringLiteral("seed"), QStringLiteral("1") });
+    parser.process(app);
+
+    QRandomGenerator random(parser.value(QStringLiteral("seed")).toUInt());
+    const QVector<Row> rows = randomRows(random, qMax(1, parser.value(QStringLiteral("rows")).toInt()));
+
+    // What CollectionListItem::refresh() keeps for each row.
+
+    QVector<Row> foldedRows;
+    foldedRows.reserve(rows.size());
+    for(const Row &row : rows) {
+        Row folded;
+        for(const QString &text : row)
+            folded.append(SearchKernel::fold(text));
+        foldedRows.append(folded);
+    }
+
+    // Queries as they're typed, some of which match nothing.
+
+    QStringList queries;
+    for(int i = 0; i < 8; ++i) {
+        const QString word = randomWord(random);
+        for(int length = 1; length <= word.length(); ++length)
+            queries.append(word.left(length).toUpper());
+    }
+    queries.append(QStringLiteral("xyzzy"));
+    queries.append(QStringLiteral("1987"));
+
+    QStringList foldedQueries;
+    for(const QString &query : qAsConst(queries))
+        foldedQueries.append(SearchKernel::fold(query));
+
+    QTextStream out(stdout);
+    out << rows.size() << " rows of " << COLUMNS << " columns, "
+        << queries.size() << " queries\n";
+
+    const Result containsBefore = measure(rows, queries, [&](const Row &row, int query) {
+        for(const QString &text : row) {
+            if(text.contains(queries[query], Qt::CaseInsensitive))
+                return true;
+        }
+        return false;
+    });
+
+    const Result containsAfter = measure(foldedRows, foldedQueries, [&](const Row &row, int query) {
+        for(const QString &text : row) {
+            if(SearchKernel::contains(text, foldedQueries[query]))
+                return true;
+        }
+        return false;
+    });
+
+    report(out, QStringLiteral("Contains"), containsBefore, containsAfter);
+
+    // Exact matches of whole cells, e.g. the genre.
+
+    QStringList cells;
+    for(int i = 0; i < 16; ++i)
+        cells.append(rows[random.bounded(rows.size())][random.bounded(COLUMNS)].toUpper());
+
+    QStringList foldedCells;
+    for(const QString &cell : qAsConst(cells))
+        foldedCells.append(SearchKernel::fold(cell));
+
+    const Result exactBefore = measure(rows, cells, [&](const Row &row, int query) {
+        const QString &cell = cells[query];
+        for(const QString &text : row) {
+            if(text.length() == cell.length() && text.toLower() == cell.toLower())
+                return true;
+        }
+        return false;
+    });
+
+    const Result exactAfter = measure(foldedRows, foldedCells, [&](const Row &row, int query) {
+        for(const QString &text : row) {
+            if(text == foldedCells[query])
+                return true;
+        }
+        return false;
+    });
+
+    report(out, QStringLiteral("Exact"), exactBefore, exactAfter);
+
+    return 0;
+}
+
+// vim: set et sw=4 tw=0 sta:
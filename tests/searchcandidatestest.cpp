@@ -0,0 +1,106 @@
+/**
+ * Copyright (C) 2026 JuK developers
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "searchcandidates.h"
+#include <QTest>
+
+class SearchCandidatesTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testMatchAll();
+    void testMatchAny();
+    void testSwitchMode();
+    void testUnindexedOnly();
+};
+
+static QBitArray bits(std::initializer_list<int> set)
+{
+    QBitArray candidates(8);
+    for(int slot : set)
+        candidates.setBit(slot);
+    return candidates;
+}
+
+void SearchCandidatesTest::testMatchAll()
+{
+    SearchCandidates candidates;
+    candidates.add(bits({ 0, 1, 2 }));
+    candidates.add(bits({ 2, 3 }));
+    candidates.addUnindexed();
+
+    QBitArray result;
+    QVERIFY(candidates.combine(PlaylistSearch::MatchAll, &result));
+    QCOMPARE(result, bits({ 2 }));
+}
+
+void SearchCandidatesTest::testMatchAny()
+{
+    SearchCandidates candidates;
+    candidates.add(bits({ 0, 1, 2 }));
+    candidates.add(bits({ 2, 3 }));
+
+    QBitArray result;
+    QVERIFY(candidates.combine(PlaylistSearch::MatchAny, &result));
+    QCOMPARE(result, bits({ 0, 1, 2, 3 }));
+
+    candidates.addUnindexed();
+    QVERIFY(!candidates.combine(PlaylistSearch::MatchAny, &result));
+    QVERIFY(result.isNull());
+}
+
+void SearchCandidatesTest::testSwitchMode()
+{
+    // Editing a search playlist adds the components first and sets the mode
+    // afterwards, the candidates have to follow the new mode.
+
+    SearchCandidates candidates;
+    candidates.add(bits({ 0, 1, 2 }));
+    candidates.addUnindexed();
+    candidates.add(bits({ 2, 3 }));
+
+    QBitArray result;
+    QVERIFY(candidates.combine(PlaylistSearch::MatchAll, &result));
+    QCOMPARE(result, bits({ 2 }));
+    QVERIFY(!candidates.combine(PlaylistSearch::MatchAny, &result));
+
+    SearchCandidates indexed;
+    indexed.add(bits({ 0, 1, 2 }));
+    indexed.add(bits({ 2, 3 }));
+
+    QVERIFY(indexed.combine(PlaylistSearch::MatchAll, &result));
+    QCOMPARE(result, bits({ 2 }));
+    QVERIFY(indexed.combine(PlaylistSearch::MatchAny, &result));
+    QCOMPARE(result, bits({ 0, 1, 2, 3 }));
+}
+
+void SearchCandidatesTest::testUnindexedOnly()
+{
+    QBitArray result;
+    QVERIFY(!SearchCandidates().combine(PlaylistSearch::MatchAll, &result));
+
+    SearchCandidates candidates;
+    candidates.addUnindexed();
+    QVERIFY(!candidates.combine(PlaylistSearch::MatchAll, &result));
+    QVERIFY(!candidates.combine(PlaylistSearch::MatchAny, &result));
+}
+
+QTEST_GUILESS_MAIN(SearchCandidatesTest)
+
+// vim: set et sw=4 tw=0 sta:
+
+#include "searchcandidatestest.moc"
@@ -21,6 +21,7 @@
 #include "playlistcollection.h"
 #include "collectionlist.h"
 #include "actioncollection.h"
+#include "cache.h"
 #include "juk_debug.h"
 
 using namespace ActionCollection;
@@ -118,34 +119,30 @@ QMap< PlaylistItem::Pointer, QPointer<Playlist> > &UpcomingPlaylist::playlistInd
 
 QDataStream &operator<<(QDataStream &s, const UpcomingPlaylist &p)
 {
-    const PlaylistItemList l = const_cast<UpcomingPlaylist *>(&p)->items();
-
-    s << qint32(l.count());
-
-    for(const auto &playlistItem : l) {
-        s << playlistItem->file().absFilePath();
-    }
-
+    Cache::instance()->writePlaylistTracks(s, const_cast<UpcomingPlaylist *>(&p)->items());
     return s;
 }
 
 QDataStream &operator>>(QDataStream &s, UpcomingPlaylist &p)
 {
-    QStringList upcomingFiles;
-    QString fileName;
-    qint32 count;
-
-    s >> count;
+    // Older versions listed the paths the same way as a QStringList.
+    const FileHandleList files = Cache::instance()->readPlaylistTracks(s);
 
-    for(qint32 i = 0; i < count; ++i) {
-        s >> fileName;
-        if(fileName.isEmpty())
-            throw BICStreamException();
+    PlaylistItemList items;
+    items.reserve(files.count());
 
-        upcomingFiles << fileName;
+    for(const auto &file : files) {
+        if(file.isNull())
+            continue;
+
+        PlaylistItem *item = CollectionList::instance()->lookup(file.absFilePath());
+        if(!item)
+            item = CollectionList::instance()->createItem(file);
+        if(item)
+            items << item;
     }
 
-    p.addFiles(upcomingFiles);
+    p.appendItems(items);
 
     return s;
 }